@@ -1,34 +1,23 @@
 #ifndef ASTAR_H
 #define ASTAR_H
 
+#include <atomic>
 #include <chrono>
-#include <future>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
+#include <tuple>
 
 #include "constants.h"
-#include "hashpair.h"
+#include "distancefield.h"
 #include "maze.h"
 #include "threadresult.h"
 
-struct AStarNode {
-    int x, y, g, h;
-    bool operator>(const AStarNode &other) const { return (g + h) > (other.g + h); }
-};
-
 class AStar {
 public:
-    static int heuristic(int x1, int y1, int x2, int y2);
-
-    static vector<pair<int, int> > reconstructPath(unordered_map<pair<int, int>, pair<int, int>, HashPair> &cameFrom,
-                                                   int startX, int startY, int goalX, int goalY);
-
-    static unordered_map<pair<int, int>, vector<pair<int, int> >, HashPair> computeAllShortestPaths(const Maze &maze);
+    // Distance to the nearest charging station and next hop of every position, from one breadth-first search over all
+    // stations. Paths are unrolled on demand with DistanceField::getPath.
+    static DistanceField computeAllShortestPaths(const Maze &maze);
 
-    static tuple<double, double, double> testAStar(const Maze &maze, int rows, int cols,
-                                                   const unordered_map<pair<int, int>, vector<pair<int, int> >,
-                                                       HashPair> &shortestPaths);
+    // Follow the paths of the field in the current maze, a path fails once one of its cells became an obstacle
+    static tuple<double, double, double> testAStar(const Maze &maze, int rows, int cols, const DistanceField &field);
 };
 
 
@@ -10,6 +10,13 @@ namespace constants {
     // Action count
     constexpr int ACTION_COUNT = 8; // Number of possible actions (up, down, left, right, and 4 diagonals)
 
+    // Row and column offsets per action (N, NE, E, SE, S, SW, W, NW), see the action layout in maze.h
+    constexpr int ROW_OFFSETS[ACTION_COUNT] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    constexpr int COL_OFFSETS[ACTION_COUNT] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+    // Hierarchy parameters
+    constexpr int LEAF_FREE_CELL_BUDGET = 400; // Subenvironments with more free cells are split further
+
     // Learning parameters
     constexpr int EPISODE_COUNT = 10'000;
     constexpr double LEARNING_RATE = 0.4;
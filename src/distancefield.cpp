@@ -0,0 +1,173 @@
+#include "distancefield.h"
+
+#include <queue>
+
+namespace {
+    // Action moving back from the neighbour reached by the given action
+    int oppositeAction(const int action) {
+        return (action + constants::ACTION_COUNT / 2) % constants::ACTION_COUNT;
+    }
+}
+
+DistanceField::DistanceField(const Maze &maze) : rows(maze.getRows()), cols(maze.getCols()),
+                                                 cells(static_cast<size_t>(rows) * cols),
+                                                 invalidatedMarks(cells.size(), 0) {
+    for (int x = 0; x < rows; ++x) {
+        for (int y = 0; y < cols; ++y) {
+            cells[x * cols + y] = maze.cell(x, y);
+        }
+    }
+    compute();
+}
+
+void DistanceField::compute() {
+    distances.assign(cells.size(), -1);
+    nextHops.assign(cells.size(), -1);
+
+    // All charging stations are sources at distance 0
+    vector<int> toExplore;
+    toExplore.reserve(cells.size());
+    for (int cell = 0; cell < static_cast<int>(cells.size()); ++cell) {
+        if (cells[cell] == constants::CHARGING_STATION) {
+            distances[cell] = 0;
+            toExplore.push_back(cell);
+        }
+    }
+
+    // Moves are symmetric, so searching outwards from the stations gives the distance towards them
+    for (size_t next = 0; next < toExplore.size(); ++next) {
+        const int cell = toExplore[next];
+        const int x = cell / cols, y = cell % cols;
+        for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+            const int newX = x + constants::ROW_OFFSETS[i];
+            const int newY = y + constants::COL_OFFSETS[i];
+            if (newX < 0 || newX >= rows || newY < 0 || newY >= cols) continue;
+            const int neighbour = newX * cols + newY;
+            if (cells[neighbour] != constants::OBSTACLE && distances[neighbour] < 0) {
+                distances[neighbour] = distances[cell] + 1;
+                nextHops[neighbour] = static_cast<int8_t>(oppositeAction(i));
+                toExplore.push_back(neighbour);
+            }
+        }
+    }
+}
+
+void DistanceField::update(const Maze &maze, const vector<pair<int, int> > &changedCells) {
+    // Cells that became obstacles or stopped being stations invalidate every path running through them. These are
+    // the cells whose chain of next hops reaches them, found by walking the next hops backwards.
+    vector<int> invalidated, opened;
+    vector<uint8_t> &isInvalidated = invalidatedMarks;
+    for (const auto &[row, col]: changedCells) {
+        const int cell = row * cols + col;
+        const int type = maze.cell(row, col);
+        if (type == cells[cell]) continue;
+        if (cells[cell] != constants::OBSTACLE && !isInvalidated[cell]) {
+            isInvalidated[cell] = 1;
+            invalidated.push_back(cell);
+        }
+        if (type != constants::OBSTACLE) {
+            opened.push_back(cell);
+        }
+        cells[cell] = type;
+    }
+    for (size_t next = 0; next < invalidated.size(); ++next) {
+        const int cell = invalidated[next];
+        const int x = cell / cols, y = cell % cols;
+        for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+            const int newX = x + constants::ROW_OFFSETS[i];
+            const int newY = y + constants::COL_OFFSETS[i];
+            if (newX < 0 || newX >= rows || newY < 0 || newY >= cols) continue;
+            const int neighbour = newX * cols + newY;
+            if (!isInvalidated[neighbour] && nextHops[neighbour] == oppositeAction(i)) {
+                isInvalidated[neighbour] = 1;
+                invalidated.push_back(neighbour);
+            }
+        }
+    }
+    for (const int cell: invalidated) {
+        distances[cell] = -1;
+        nextHops[cell] = -1;
+        isInvalidated[cell] = 0;
+    }
+
+    // Seed the repair with the best distance every invalidated or opened cell gets from its valid neighbours
+    priority_queue<pair<int, int>, vector<pair<int, int> >, greater<> > toRepair;
+    auto seed = [this, &toRepair](const int cell) {
+        if (cells[cell] == constants::OBSTACLE) return;
+        if (cells[cell] == constants::CHARGING_STATION) {
+            distances[cell] = 0;
+            nextHops[cell] = -1;
+            toRepair.emplace(0, cell);
+            return;
+        }
+        const int x = cell / cols, y = cell % cols;
+        for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+            const int newX = x + constants::ROW_OFFSETS[i];
+            const int newY = y + constants::COL_OFFSETS[i];
+            if (newX < 0 || newX >= rows || newY < 0 || newY >= cols) continue;
+            const int neighbour = newX * cols + newY;
+            if (cells[neighbour] == constants::OBSTACLE || distances[neighbour] < 0) continue;
+            if (distances[cell] < 0 || distances[neighbour] + 1 < distances[cell]) {
+                distances[cell] = distances[neighbour] + 1;
+                nextHops[cell] = static_cast<int8_t>(i);
+            }
+        }
+        if (distances[cell] >= 0) {
+            toRepair.emplace(distances[cell], cell);
+        }
+    };
+    for (const int cell: invalidated) seed(cell);
+    for (const int cell: opened) seed(cell);
+
+    // Lower the distances outwards from the seeds in order of distance (Dijkstra with unit costs)
+    while (!toRepair.empty()) {
+        const auto [distance, cell] = toRepair.top();
+        toRepair.pop();
+        if (distance != distances[cell]) continue; // Outdated entry
+
+        const int x = cell / cols, y = cell % cols;
+        for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+            const int newX = x + constants::ROW_OFFSETS[i];
+            const int newY = y + constants::COL_OFFSETS[i];
+            if (newX < 0 || newX >= rows || newY < 0 || newY >= cols) continue;
+            const int neighbour = newX * cols + newY;
+            if (cells[neighbour] == constants::OBSTACLE) continue;
+            if (distances[neighbour] < 0 || distance + 1 < distances[neighbour]) {
+                distances[neighbour] = distance + 1;
+                nextHops[neighbour] = static_cast<int8_t>(oppositeAction(i));
+                toRepair.emplace(distance + 1, neighbour);
+            }
+        }
+    }
+}
+
+int DistanceField::getRows() const {
+    return rows;
+}
+
+int DistanceField::getCols() const {
+    return cols;
+}
+
+int DistanceField::getDistance(const int row, const int col) const {
+    return distances[row * cols + col];
+}
+
+int DistanceField::getNextHop(const int row, const int col) const {
+    return nextHops[row * cols + col];
+}
+
+vector<pair<int, int> > DistanceField::getPath(int row, int col) const {
+    vector<pair<int, int> > path;
+    if (distances[row * cols + col] < 0) return path;
+
+    path.reserve(distances[row * cols + col] + 1);
+    path.emplace_back(row, col);
+    while (distances[row * cols + col] > 0) {
+        const int act = nextHops[row * cols + col];
+        row += constants::ROW_OFFSETS[act];
+        col += constants::COL_OFFSETS[act];
+        path.emplace_back(row, col);
+    }
+    return path;
+}
@@ -0,0 +1,46 @@
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "maze.h"
+
+using namespace std;
+
+// Steps from every cell to the nearest charging station (all 8 moves cost 1) together with the action leading one
+// step closer, stored densely. When obstacles move the field is repaired in place: only the cells whose shortest path
+// ran through a blocked cell, or that get closer through a freed cell, are updated (LPA*-style repair).
+class DistanceField {
+public:
+    // Breadth-first search from all charging stations at once
+    explicit DistanceField(const Maze &maze);
+
+    // Repair the field after the given cells changed type in the maze (unchanged cells in the list are ignored)
+    void update(const Maze &maze, const vector<pair<int, int> > &changedCells);
+
+    [[nodiscard]] int getRows() const;
+
+    [[nodiscard]] int getCols() const;
+
+    // Steps to the nearest charging station, -1 for obstacles and cells without a path
+    [[nodiscard]] int getDistance(int row, int col) const;
+
+    // Action leading one step closer to a charging station, -1 for stations and cells without a path
+    [[nodiscard]] int getNextHop(int row, int col) const;
+
+    // Path from the cell to its nearest charging station (both included), empty if there is none
+    [[nodiscard]] vector<pair<int, int> > getPath(int row, int col) const;
+
+private:
+    int rows, cols;
+    vector<uint8_t> cells; // Cell types of the maze the field belongs to
+    vector<int> distances;
+    vector<int8_t> nextHops;
+    vector<uint8_t> invalidatedMarks; // Scratch space of update, all zero between calls
+
+    void compute();
+};
+
+#endif //DISTANCEFIELD_H
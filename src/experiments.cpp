@@ -1,7 +1,7 @@
 #include "experiments.h"
 
-void Experiments::simulateEnvironmentChanges(const TreeNode *root, const int numSteps,
-                                             vector<pair<int, int> > &changedPositions) {
+void Experiments::simulateEnvironmentChanges(TreeNode *root, const int numSteps,
+                                             vector<pair<int, int> > &changedPositions, Rng &rng) {
     if (!root) {
         cerr << "Error: Root node is null.\n";
         return;
@@ -16,7 +16,7 @@ void Experiments::simulateEnvironmentChanges(const TreeNode *root, const int num
     for (int step = 0; step < numSteps; ++step) {
         // Randomly select an obstacle to move (based on the set seed value)
         if (!obstaclePositions.empty()) {
-            const int randomIndex = rand() % obstaclePositions.size();
+            const int randomIndex = rng.nextInt(static_cast<int>(obstaclePositions.size()));
             int oldRow = obstaclePositions[randomIndex].first;
             int oldCol = obstaclePositions[randomIndex].second;
 
@@ -44,7 +44,7 @@ void Experiments::simulateEnvironmentChanges(const TreeNode *root, const int num
 
             // If there are valid moves, randomly select one
             if (!validMoves.empty()) {
-                const int moveIndex = rand() % validMoves.size();
+                const int moveIndex = rng.nextInt(static_cast<int>(validMoves.size()));
                 int newRow = validMoves[moveIndex].first;
                 int newCol = validMoves[moveIndex].second;
 
@@ -53,15 +53,180 @@ void Experiments::simulateEnvironmentChanges(const TreeNode *root, const int num
                 changedPositions.emplace_back(newRow, newCol);
 
                 // Move the obstacle
-                (*root->maze)(oldRow, oldCol, constants::FREE_SPACE);
-                (*root->maze)(newRow, newCol, constants::OBSTACLE);
+                const CellChange move[] = {
+                    {oldRow, oldCol, constants::FREE_SPACE},
+                    {newRow, newCol, constants::OBSTACLE}
+                };
+                root->applyMazeChanges(move);
                 obstaclePositions[randomIndex] = {newRow, newCol};
             }
         }
     }
 }
 
-void Experiments::runFullExperiment(bool visualize) {
+Metrics Experiments::runApproach(const string &name, const Maze &initialMaze,
+                                 const vector<pair<int, vector<pair<int, int> > > > &changeSequence, const int d,
+                                 const string &diffName, const bool visualize, ostream &detailedOut, ostream &log) {
+    const int size = initialMaze.getRows();
+    const int maxTimeSteps = static_cast<int>(changeSequence.size());
+    log << "\n\nTesting " << name << " - Size: " << size << ", Difficulty: " << diffName << endl;
+
+    // Create the root node for the current approach
+    auto *root = new TreeNode(initialMaze, size, size, 0, 0, size - 1, size - 1, nullptr, true);
+    root->createSubEnvironments(initialMaze);
+
+    // Master random number stream for training, derived from the size and difficulty of the configuration. Every
+    // approach of a configuration starts from the same seed.
+    Rng trainingRng(d + 50, size);
+
+    unique_ptr<DistanceField> oracleField; // Repaired in place by the "A* Oracle" approach
+    double totalInitialTime = 0.0, totalAdaptTime = 0.0, totalSuccessRate = 0.0, totalPathLength = 0.0;
+    int stepsCompleted = 0;
+
+    // Inspect the distribution of charging stations across the maze
+    root->printTree(log);
+
+    // Initialize visualization
+    unique_ptr<PolicyVisualizer> visualizer;
+    if (visualize) {
+        if (name == "singleAgent" || name == "singleAgentPrioritized" || name == "fedAsynQ_EqAvg" ||
+            name == "fedAsynQ_ImAvg") {
+            visualizer = make_unique<PolicyVisualizer>(root, size, name, maxTimeSteps);
+            visualizer->update();
+            visualizer->render();
+        }
+    }
+
+    // Initial training
+    if (name == "A* Oracle" || name == "A* Static") {
+        auto start = chrono::high_resolution_clock::now();
+        oracleField = make_unique<DistanceField>(AStar::computeAllShortestPaths(*root->maze));
+        auto end = chrono::high_resolution_clock::now();
+        totalInitialTime = chrono::duration<double>(end - start).count();
+    } else {
+        auto start = chrono::high_resolution_clock::now();
+        if (name == "onlyTrainLeafNodes") TreeStrategy::onlyTrainLeafNodes(root, trainingRng);
+        else if (name == "singleAgent")
+            TreeStrategy::smartHierarchy(root, trainingRng, {}, "singleAgent");
+        else if (name == "singleAgentPrioritized")
+            TreeStrategy::smartHierarchy(root, trainingRng, {}, "singleAgentPrioritized");
+        else if (name == "fedAsynQ_EqAvg")
+            TreeStrategy::smartHierarchy(root, trainingRng, {}, "fedAsynQ_EqAvg");
+        else if (name == "fedAsynQ_ImAvg")
+            TreeStrategy::smartHierarchy(root, trainingRng, {}, "fedAsynQ_ImAvg");
+        auto end = chrono::high_resolution_clock::now();
+        totalInitialTime = chrono::duration<double>(end - start).count();
+    }
+
+    // Test initial performance
+    auto [_, successRate, avgPath] = (name == "A* Oracle" || name == "A* Static")
+                                         ? AStar::testAStar(*root->maze, size, size, *oracleField)
+                                         : TestPolicy::testAgent(root);
+    totalSuccessRate += successRate;
+    totalPathLength += avgPath;
+    stepsCompleted++;
+
+    // Write initial data
+    detailedOut << name << "," << size << "," << diffName << ",0,0,"
+            << 0.0 << "," << successRate << "," << avgPath << "\n";
+
+    // Apply changes over time, in place on the root's maze
+    vector<CellChange> batch;
+    for (int t = 0; t < maxTimeSteps; ++t) {
+        const auto &[numChanges, changes] = changeSequence[t];
+        batch.clear();
+        for (int i = 0; i < changes.size(); i += 2) {
+            batch.push_back({changes[i].first, changes[i].second, constants::FREE_SPACE});
+            batch.push_back({changes[i + 1].first, changes[i + 1].second, constants::OBSTACLE});
+        }
+        const vector<pair<int, int> > changedCells = root->applyMazeChanges(batch);
+
+        unordered_set<TreeNode *> changedLeaves;
+        for (const auto &[r, c]: changedCells) {
+            TreeNode *leaf = root->findSubEnvironment(r, c);
+            if (leaf && leaf->children.empty()) changedLeaves.insert(leaf);
+        }
+        vector<TreeNode *> changedLeafSet(changedLeaves.begin(), changedLeaves.end());
+
+        // Adaptation
+        double adaptTime;
+        if (name == "A* Oracle") {
+            // Only the distances affected by the moved obstacles are repaired
+            auto start = chrono::high_resolution_clock::now();
+            oracleField->update(*root->maze, changedCells);
+            auto end = chrono::high_resolution_clock::now();
+            adaptTime = chrono::duration<double>(end - start).count();
+        } else if (name == "A* Static") {
+            adaptTime = 0.0; // No adaptation
+        } else {
+            auto start = chrono::high_resolution_clock::now();
+            if (name == "onlyTrainLeafNodes")
+                TreeStrategy::onlyTrainLeafNodes(root, trainingRng, changedLeafSet);
+            else if (name == "singleAgent")
+                TreeStrategy::smartHierarchy(
+                    root, trainingRng, changedLeafSet, "singleAgent");
+            else if (name == "singleAgentPrioritized")
+                TreeStrategy::smartHierarchy(
+                    root, trainingRng, changedLeafSet, "singleAgentPrioritized");
+            else if (name == "fedAsynQ_EqAvg")
+                TreeStrategy::smartHierarchy(
+                    root, trainingRng, changedLeafSet, "fedAsynQ_EqAvg");
+            else if (name == "fedAsynQ_ImAvg")
+                TreeStrategy::smartHierarchy(
+                    root, trainingRng, changedLeafSet, "fedAsynQ_ImAvg");
+            auto end = chrono::high_resolution_clock::now();
+            adaptTime = chrono::duration<double>(end - start).count();
+        }
+
+        // Test performance after adaptation
+        auto [_, stepSuccessRate, stepAvgPath] = (name == "A* Oracle" || name == "A* Static")
+                                                     ? AStar::testAStar(
+                                                         *root->maze, size, size, *oracleField)
+                                                     : TestPolicy::testAgent(root);
+        totalAdaptTime += adaptTime;
+        totalSuccessRate += stepSuccessRate;
+        totalPathLength += stepAvgPath;
+        stepsCompleted++;
+
+        // Update visualization
+        if (visualize) {
+            if (visualizer) {
+                visualizer->update();
+                visualizer->render();
+                // Brief delay to ensure smooth rendering
+                sf::sleep(sf::milliseconds(500));
+            }
+        }
+
+        // Write per-step data
+        detailedOut << name << "," << size << "," << diffName << "," << t + 1 << ","
+                << numChanges << "," << adaptTime << "," << stepSuccessRate << ","
+                << stepAvgPath << "\n";
+
+        // Check if window is still open
+        if (visualize) {
+            if (visualizer && !visualizer->isOpen()) {
+                break;
+            }
+        }
+    }
+
+    // Finalize results
+    log << "\n" << name << " - Size: " << size << ", Difficulty: " << diffName
+            << ", Initial Time: " << totalInitialTime << "s, Adapt Time: " << totalAdaptTime
+            << "s, Success Rate: " << (totalSuccessRate / stepsCompleted) * 100
+            << "%, Avg Path Length: " << (totalPathLength / stepsCompleted) << " steps";
+
+    delete root;
+    return {
+        totalInitialTime,
+        totalAdaptTime / maxTimeSteps,
+        totalSuccessRate / stepsCompleted,
+        totalPathLength / stepsCompleted
+    };
+}
+
+void Experiments::runFullExperiment(const bool visualize, int maxConcurrentJobs) {
     vector<int> sizes = {20, 50, 100, 200, 300};
     vector<tuple<double, double, double> > difficulties = {
         {0.8, 0.18, 0.02}, // Easy
@@ -74,29 +239,16 @@ void Experiments::runFullExperiment(bool visualize) {
         "A* Oracle",
         "onlyTrainLeafNodes",
         "singleAgent",
+        "singleAgentPrioritized",
         "fedAsynQ_EqAvg",
         "fedAsynQ_ImAvg"
     };
 
-    // Detailed output file for per-step data
-    ofstream detailedOut("results_detailed.csv");
-    detailedOut << "Approach,Size,Difficulty,TimeStep,NumChanges,AdaptTime,SuccessRate,AvgPathLength\n";
-
-    // Map to store results
-    map<string, vector<vector<Metrics> > > results;
-    for (const string &name: approaches) {
-        results[name].resize(sizes.size());
-        for (int s = 0; s < sizes.size(); ++s) {
-            results[name][s].resize(difficulties.size());
-        }
-    }
-
-    // Iterate over maze sizes and difficulties
+    // Generate the maze and change sequence of every configuration up front. The maze generator uses rand(), so this
+    // stays sequential and every configuration gets the same layout regardless of how the runs are scheduled.
+    vector<Scenario> scenarios;
     for (int s = 0; s < sizes.size(); ++s) {
         int size = sizes[s];
-        cout << "\n\nTesting maze size: " << size << "x" << size;
-
-        // Iterate over difficulties
         for (int d = 0; d < difficulties.size(); ++d) {
             srand(d + 50);
 
@@ -105,23 +257,23 @@ void Experiments::runFullExperiment(bool visualize) {
             // at least half the maze to reach the charging station.
 
             auto [freeProb, obstProb, chargeProb] = difficulties[d];
-            string diffName = (d == 0 ? "Easy" : d == 1 ? "Medium" : "Hard");
-            cout << "\n\nDifficulty: " << diffName;
 
             // Simple scaling: maxTimeSteps proportional to size
             constexpr int k = 2;
             const int maxTimeSteps = k * size;
-            cout << " - maxTimeSteps: " << maxTimeSteps;
 
             // Create initial maze
             Maze initialMaze(size, size, freeProb, obstProb, chargeProb);
+
+            // Random number stream for the environment changes, seeded like the maze
+            Rng changeRng(d + 50);
             vector<pair<int, vector<pair<int, int> > > > changeSequence(maxTimeSteps);
             auto *tempRoot = new TreeNode(initialMaze, size, size, 0, 0, size - 1, size - 1, nullptr, true);
             tempRoot->createSubEnvironments(initialMaze);
 
             // Determine the number of changes per time step up front
             for (int t = 0; t < maxTimeSteps; ++t) {
-                int r = rand() % 1000;
+                int r = changeRng.nextInt(1000);
                 int numChanges;
                 if (r < 900) numChanges = 1;
                 else if (r < 950) numChanges = 2;
@@ -134,171 +286,99 @@ void Experiments::runFullExperiment(bool visualize) {
                 else if (r < 999) numChanges = 9;
                 else numChanges = 10;
                 changeSequence[t].first = numChanges;
-                simulateEnvironmentChanges(tempRoot, numChanges, changeSequence[t].second);
+                simulateEnvironmentChanges(tempRoot, numChanges, changeSequence[t].second, changeRng);
             }
             delete tempRoot;
 
-            // Iterate over approaches
-            for (const string &name: approaches) {
-                cout << "\n\nTesting " << name << endl;
-
-                // Create the root node for the current approach
-                auto *root = new TreeNode(initialMaze, size, size, 0, 0, size - 1, size - 1, nullptr, true);
-                root->createSubEnvironments(initialMaze);
-
-                unordered_map<pair<int, int>, vector<pair<int, int> >, HashPair> shortestPaths;
-                double totalInitialTime = 0.0, totalAdaptTime = 0.0, totalSuccessRate = 0.0, totalPathLength = 0.0;
-                int stepsCompleted = 0;
-
-                // Inspect the distribution of charging stations across the maze
-                root->printTree();
-
-                // Initialize visualization
-                unique_ptr<PolicyVisualizer> visualizer;
-                if (visualize) {
-                    if (name == "singleAgent" || name == "fedAsynQ_EqAvg" || name == "fedAsynQ_ImAvg") {
-                        visualizer = make_unique<PolicyVisualizer>(root, size, name, maxTimeSteps);
-                        visualizer->update();
-                        visualizer->render();
-                    }
-                }
-
-                // Initial training
-                if (name == "A* Oracle" || name == "A* Static") {
-                    auto start = chrono::high_resolution_clock::now();
-                    shortestPaths = AStar::computeAllShortestPaths(*root->maze);
-                    auto end = chrono::high_resolution_clock::now();
-                    totalInitialTime = chrono::duration<double>(end - start).count();
-                } else {
-                    auto start = chrono::high_resolution_clock::now();
-                    if (name == "onlyTrainLeafNodes") TreeStrategy::onlyTrainLeafNodes(root);
-                    else if (name == "singleAgent") TreeStrategy::smartHierarchy(root, {}, "singleAgent");
-                    else if (name == "fedAsynQ_EqAvg") TreeStrategy::smartHierarchy(root, {}, "fedAsynQ_EqAvg");
-                    else if (name == "fedAsynQ_ImAvg") TreeStrategy::smartHierarchy(root, {}, "fedAsynQ_ImAvg");
-                    auto end = chrono::high_resolution_clock::now();
-                    totalInitialTime = chrono::duration<double>(end - start).count();
-                }
+            scenarios.push_back({size, d, move(initialMaze), move(changeSequence)});
+        }
+    }
 
-                // Test initial performance
-                auto [_, successRate, avgPath] = (name == "A* Oracle" || name == "A* Static")
-                                                     ? AStar::testAStar(*root->maze, size, size, shortestPaths)
-                                                     : TestPolicy::testAgent(root);
-                totalSuccessRate += successRate;
-                totalPathLength += avgPath;
-                stepsCompleted++;
-
-                // Write initial data
-                detailedOut << name << "," << size << "," << diffName << ",0,0,"
-                        << 0.0 << "," << successRate << "," << avgPath << "\n";
-
-                // Apply changes over time
-                Maze currentMaze = initialMaze;
-                for (int t = 0; t < maxTimeSteps; ++t) {
-                    const auto &[numChanges, changes] = changeSequence[t];
-                    for (int i = 0; i < changes.size(); i += 2) {
-                        currentMaze(changes[i].first, changes[i].second, constants::FREE_SPACE);
-                        currentMaze(changes[i + 1].first, changes[i + 1].second, constants::OBSTACLE);
-                    }
-                    root->maze = make_unique<Maze>(currentMaze);
-
-                    unordered_set<TreeNode *> changedLeaves;
-                    for (const auto &[r, c]: changes) {
-                        TreeNode *leaf = root->findSubEnvironment(r, c);
-                        if (leaf && leaf->children.empty()) changedLeaves.insert(leaf);
-                    }
-                    vector<TreeNode *> changedLeafSet(changedLeaves.begin(), changedLeaves.end());
-
-                    // Adaptation
-                    double adaptTime;
-                    if (name == "A* Oracle") {
-                        auto start = chrono::high_resolution_clock::now();
-                        shortestPaths = AStar::computeAllShortestPaths(*root->maze);
-                        auto end = chrono::high_resolution_clock::now();
-                        adaptTime = chrono::duration<double>(end - start).count();
-                    } else if (name == "A* Static") {
-                        adaptTime = 0.0; // No adaptation
-                    } else {
-                        auto start = chrono::high_resolution_clock::now();
-                        if (name == "onlyTrainLeafNodes") TreeStrategy::onlyTrainLeafNodes(root, changedLeafSet);
-                        else if (name == "singleAgent")
-                            TreeStrategy::smartHierarchy(
-                                root, changedLeafSet, "singleAgent");
-                        else if (name == "fedAsynQ_EqAvg")
-                            TreeStrategy::smartHierarchy(
-                                root, changedLeafSet, "fedAsynQ_EqAvg");
-                        else if (name == "fedAsynQ_ImAvg")
-                            TreeStrategy::smartHierarchy(
-                                root, changedLeafSet, "fedAsynQ_ImAvg");
-                        auto end = chrono::high_resolution_clock::now();
-                        adaptTime = chrono::duration<double>(end - start).count();
-                    }
-
-                    // Test performance after adaptation
-                    auto [_, stepSuccessRate, stepAvgPath] = (name == "A* Oracle" || name == "A* Static")
-                                                                 ? AStar::testAStar(
-                                                                     *root->maze, size, size, shortestPaths)
-                                                                 : TestPolicy::testAgent(root);
-                    totalAdaptTime += adaptTime;
-                    totalSuccessRate += stepSuccessRate;
-                    totalPathLength += stepAvgPath;
-                    stepsCompleted++;
-
-                    // Update visualization
-                    if (visualize) {
-                        if (visualizer) {
-                            visualizer->update();
-                            visualizer->render();
-                            // Brief delay to ensure smooth rendering
-                            sf::sleep(sf::milliseconds(500));
-                        }
-                    }
-
-                    // Write per-step data
-                    detailedOut << name << "," << size << "," << diffName << "," << t + 1 << ","
-                            << numChanges << "," << adaptTime << "," << stepSuccessRate << ","
-                            << stepAvgPath << "\n";
-
-                    // Check if window is still open
-                    if (visualize) {
-                        if (visualizer && !visualizer->isOpen()) {
-                            break;
-                        }
-                    }
-                }
+    // One job per configuration and approach, started with the largest mazes to keep the tail of the sweep short
+    const int approachCount = static_cast<int>(approaches.size());
+    const int jobCount = static_cast<int>(scenarios.size()) * approachCount;
+    vector<int> jobOrder(jobCount);
+    iota(jobOrder.begin(), jobOrder.end(), 0);
+    ranges::stable_sort(jobOrder, greater<>(), [&](const int job) { return scenarios[job / approachCount].size; });
+
+    // Run the jobs, at most maxConcurrentJobs at a time (by default one per four hardware threads). Visualization
+    // needs the calling thread.
+    if (visualize) {
+        maxConcurrentJobs = 1;
+    } else if (maxConcurrentJobs <= 0) {
+        maxConcurrentJobs = static_cast<int>(max(1u, thread::hardware_concurrency() / 4));
+    }
 
-                // Finalize results
-                cout << "\n" << name << " - Size: " << size << ", Difficulty: " << diffName
-                        << ", Initial Time: " << totalInitialTime << "s, Adapt Time: " << totalAdaptTime
-                        << "s, Success Rate: " << (totalSuccessRate / stepsCompleted) * 100
-                        << "%, Avg Path Length: " << (totalPathLength / stepsCompleted) << " steps";
-
-                results[name][s][d] = {
-                    totalInitialTime,
-                    totalAdaptTime / maxTimeSteps,
-                    totalSuccessRate / stepsCompleted,
-                    totalPathLength / stepsCompleted
-                };
+    // Every job buffers its own results, so the output does not depend on the order in which jobs finish. Concurrent
+    // jobs also buffer their console log, which is printed in configuration order once all jobs are done.
+    vector<Metrics> jobResults(jobCount);
+    vector<string> jobDetails(jobCount);
+    vector<string> jobLogs(jobCount);
+    auto runJob = [&](const int job) {
+        const Scenario &scenario = scenarios[job / approachCount];
+        const string &name = approaches[job % approachCount];
+        const int d = scenario.difficulty;
+        const string diffName = (d == 0 ? "Easy" : d == 1 ? "Medium" : "Hard");
+        ostringstream details;
+        if (maxConcurrentJobs == 1) {
+            jobResults[job] = runApproach(name, scenario.initialMaze, scenario.changeSequence, d, diffName, visualize,
+                                          details, cout);
+        } else {
+            ostringstream log;
+            jobResults[job] = runApproach(name, scenario.initialMaze, scenario.changeSequence, d, diffName, visualize,
+                                          details, log);
+            jobLogs[job] = log.str();
+        }
+        jobDetails[job] = details.str();
+    };
 
-                delete root;
-            }
+    if (maxConcurrentJobs == 1) {
+        for (const int job: jobOrder) {
+            runJob(job);
+        }
+    } else {
+        // Every runner owns a pool with an equal share of the hardware threads, so the parallel training and
+        // evaluation of concurrent jobs never compete for the same workers and the measured times only depend on
+        // that share
+        const int threadsPerJob = max(1, static_cast<int>(thread::hardware_concurrency()) / maxConcurrentJobs);
+        atomic<int> nextJob = 0;
+        vector<thread> runners;
+        for (int r = 0; r < min(maxConcurrentJobs, jobCount); ++r) {
+            runners.emplace_back([&] {
+                ThreadPool jobPool(threadsPerJob - 1); // The runner is the remaining thread
+                ThreadPool::assignCurrentThread(&jobPool);
+                for (int i = nextJob++; i < jobCount; i = nextJob++) {
+                    runJob(jobOrder[i]);
+                }
+                ThreadPool::assignCurrentThread(nullptr);
+            });
+        }
+        for (thread &runner: runners) {
+            runner.join();
         }
+        for (const string &log: jobLogs) {
+            cout << log;
+        }
+    }
+
+    // Detailed output file for per-step data, merged in configuration order
+    ofstream detailedOut("results_detailed.csv");
+    detailedOut << "Approach,Size,Difficulty,TimeStep,NumChanges,AdaptTime,SuccessRate,AvgPathLength\n";
+    for (const string &details: jobDetails) {
+        detailedOut << details;
     }
     detailedOut.close();
 
     // Save aggregated results
     ofstream out("results.csv");
     out << "Approach,Size,Difficulty,InitialTime,AdaptTimePerStep,AvgSuccessRate,AvgPathLength\n";
-    for (int s = 0; s < sizes.size(); ++s) {
-        int size = sizes[s];
-        for (int d = 0; d < difficulties.size(); ++d) {
-            string diffName = (d == 0 ? "Easy" : d == 1 ? "Medium" : "Hard");
-            for (const string &name: approaches) {
-                const auto &m = results[name][s][d];
-                out << name << "," << size << "," << diffName << ","
-                        << m.initialTime << "," << m.adaptTime << "," << m.successRate << "," << m.avgPathLength <<
-                        "\n";
-            }
-        }
+    for (int job = 0; job < jobCount; ++job) {
+        const Scenario &scenario = scenarios[job / approachCount];
+        const int d = scenario.difficulty;
+        string diffName = (d == 0 ? "Easy" : d == 1 ? "Medium" : "Hard");
+        const auto &m = jobResults[job];
+        out << approaches[job % approachCount] << "," << scenario.size << "," << diffName << ","
+                << m.initialTime << "," << m.adaptTime << "," << m.successRate << "," << m.avgPathLength << "\n";
     }
     out.close();
 }
@@ -2,8 +2,11 @@
 #define EXPERIMENTS_H
 
 #include <chrono>
+#include <atomic>
 #include <fstream>
-#include <map>
+#include <numeric>
+#include <sstream>
+#include <thread>
 
 #include "astar.h"
 #include "policyvisualizer.h"
@@ -18,12 +21,27 @@ struct Metrics {
     double avgPathLength;
 };
 
+// Maze and change sequence shared by every approach of one (size, difficulty) configuration
+struct Scenario {
+    int size;
+    int difficulty;
+    Maze initialMaze;
+    vector<pair<int, vector<pair<int, int> > > > changeSequence;
+};
+
 class Experiments {
 public:
-    static void simulateEnvironmentChanges(const TreeNode *root, int numSteps,
-                                           vector<pair<int, int> > &changedPositions);
+    static void simulateEnvironmentChanges(TreeNode *root, int numSteps,
+                                           vector<pair<int, int> > &changedPositions, Rng &rng);
+
+    // Trains and evaluates one approach on one configuration, writing its per-step rows to detailedOut and its
+    // progress summary to log
+    static Metrics runApproach(const string &name, const Maze &initialMaze,
+                               const vector<pair<int, vector<pair<int, int> > > > &changeSequence, int d,
+                               const string &diffName, bool visualize, ostream &detailedOut, ostream &log);
 
-    static void runFullExperiment(bool visualize);
+    // Runs every approach on every configuration, at most maxConcurrentJobs at a time (0 picks a default)
+    static void runFullExperiment(bool visualize, int maxConcurrentJobs = 0);
 };
 
 
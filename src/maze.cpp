@@ -1,7 +1,8 @@
 #include "maze.h"
 
 Maze::Maze(const int rows, const int cols, const double freeSpaceProb, const double obstacleProb,
-           const double chargingStationProb) : vector<vector<int> >(rows, vector<int>(cols)) {
+           const double chargingStationProb) : rows(rows), cols(cols), stride(cols + 2),
+                                               grid(static_cast<size_t>(rows + 2) * (cols + 2), constants::OBSTACLE) {
     // Validate that the probabilities sum to 1
     if (abs(freeSpaceProb + obstacleProb + chargingStationProb - 1.0) > 1e-6) {
         cerr << "Error: Probabilities must sum to 1." << endl;
@@ -14,11 +15,11 @@ Maze::Maze(const int rows, const int cols, const double freeSpaceProb, const dou
         for (int j = 0; j < cols; j++) {
             const double randomValue = static_cast<double>(rand()) / RAND_MAX;
             if (randomValue < freeSpaceProb) {
-                (*this)[i][j] = constants::FREE_SPACE; // Free space
+                grid[index(i, j)] = constants::FREE_SPACE; // Free space
             } else if (randomValue < freeSpaceProb + obstacleProb) {
-                (*this)[i][j] = constants::OBSTACLE; // Obstacle
+                grid[index(i, j)] = constants::OBSTACLE; // Obstacle
             } else {
-                (*this)[i][j] = constants::CHARGING_STATION; // Charging station
+                grid[index(i, j)] = constants::CHARGING_STATION; // Charging station
                 hasChargingStation = true;
             }
         }
@@ -28,7 +29,15 @@ Maze::Maze(const int rows, const int cols, const double freeSpaceProb, const dou
     if (!hasChargingStation) {
         const int randomRow = rand() % rows;
         const int randomCol = rand() % cols;
-        (*this)[randomRow][randomCol] = constants::CHARGING_STATION; // Place a charging station
+        grid[index(randomRow, randomCol)] = constants::CHARGING_STATION; // Place a charging station
+    }
+
+    // Precompute the transitions of every cell
+    transitions.resize(static_cast<size_t>(rows) * cols * constants::ACTION_COUNT);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            computeTransitions(i, j);
+        }
     }
 }
 
@@ -39,17 +48,48 @@ int Maze::operator()(const int row, const int col) const {
         exit(1);
     }
     // Check if the position is valid
-    if ((*this)[row][col] != constants::FREE_SPACE && (*this)[row][col] != constants::OBSTACLE && (*this)[row][col] !=
-        constants::CHARGING_STATION) {
+    const int value = cell(row, col);
+    if (value != constants::FREE_SPACE && value != constants::OBSTACLE && value != constants::CHARGING_STATION) {
         cerr << "Error: Invalid cell type at (" << row << ", " << col << ")." << endl;
         exit(1);
     }
-    return (*this)[row][col];
+    return value;
 }
 
 void Maze::operator()(const int row, const int col, const int value) {
+    validateUpdate(row, col, value);
+
+    // Set the value at the specified position
+    grid[index(row, col)] = static_cast<uint8_t>(value);
+
+    // Refresh the transitions into and out of the changed cell
+    updateTransitionsAround(row, col);
+}
+
+vector<CellChange> Maze::applyChanges(const span<const CellChange> changes) {
+    // Write the cells in order, remembering the type every touched cell had before the batch. Batches are a handful of
+    // moved obstacles, so a linear search over the touched cells is enough.
+    vector<CellChange> touched;
+    for (const auto &[row, col, value]: changes) {
+        validateUpdate(row, col, value);
+        uint8_t &cellValue = grid[index(row, col)];
+        if (ranges::none_of(touched, [&](const CellChange &c) { return c.row == row && c.col == col; })) {
+            touched.push_back({row, col, cellValue});
+        }
+        cellValue = static_cast<uint8_t>(value);
+    }
+
+    // Only the cells that ended up with another type affect the transitions
+    erase_if(touched, [this](const CellChange &c) { return cell(c.row, c.col) == c.value; });
+    for (const auto &[row, col, value]: touched) {
+        updateTransitionsAround(row, col);
+    }
+    return touched;
+}
+
+void Maze::validateUpdate(const int row, const int col, const int value) const {
     // Check bounds
-    if (row < 0 || row >= size() || col < 0 || col >= (*this)[row].size()) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) {
         cerr << "Error: Index out of bounds." << endl;
         exit(1);
     }
@@ -58,14 +98,12 @@ void Maze::operator()(const int row, const int col, const int value) {
         cerr << "Error: Invalid cell type value." << endl;
         exit(1);
     }
-    // Set the value at the specified position
-    (*this)[row][col] = value;
 }
 
 void Maze::printMaze() const {
-    for (const auto &row: *this) {
-        for (const auto &cell: row) {
-            switch (cell) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            switch (cell(i, j)) {
                 case constants::FREE_SPACE:
                     cout << ".";
                     break;
@@ -84,153 +122,96 @@ void Maze::printMaze() const {
 }
 
 int Maze::getRows() const {
-    return this->size();
+    return rows;
 }
 
 int Maze::getCols() const {
-    return this->empty() ? 0 : (*this)[0].size();
+    return cols;
 }
 
 bool Maze::checkExit(const int x, const int y) const {
-    return (*this)[x][y] == constants::CHARGING_STATION;
+    return cell(x, y) == constants::CHARGING_STATION;
 }
 
-pair<int, int> Maze::selectFirstPlace(const int startRow, const int startCol, const int endRow,
-                                      const int endCol) const {
+pair<int, int> Maze::selectFirstPlace(const int startRow, const int startCol, const int endRow, const int endCol,
+                                      Rng &rng) const {
     int x, y;
     // Keep generating random indices until a free space is found
     do {
-        x = rand() % (endRow - startRow) + startRow;
-        y = rand() % (endCol - startCol) + startCol;
-    } while ((*this)[x][y] != constants::FREE_SPACE);
+        x = rng.nextInt(endRow - startRow) + startRow;
+        y = rng.nextInt(endCol - startCol) + startCol;
+    } while (cell(x, y) != constants::FREE_SPACE);
     return make_pair(x, y);
 }
 
 pair<int, int> Maze::selectFirstPlace(const int startRow, const int startCol, const int endRow, const int endCol,
-                                      const int counter,
-                                      const unordered_map<pair<int, int>, StartStats, HashPair> &startStats,
-                                      mt19937 &rng) const {
+                                      const int counter, const StartStatsGrid &startStats, Rng &rng) const {
     constexpr int initialRandomEpisodes = 10;
     if (counter < initialRandomEpisodes || startStats.empty()) {
         int r, c;
         do {
-            r = startRow + rand() % (endRow - startRow + 1);
-            c = startCol + rand() % (endCol - startCol + 1);
-        } while ((*this)[r][c] == constants::OBSTACLE);
+            r = startRow + rng.nextInt(endRow - startRow + 1);
+            c = startCol + rng.nextInt(endCol - startCol + 1);
+        } while (cell(r, c) == constants::OBSTACLE);
         return {r, c};
     }
 
-    // Build weights: lower success rate = higher weight
-    vector<pair<int, int> > positions;
-    vector<double> weights;
-    constexpr double epsilon = 0.1; // Ensure non-zero probability
-    for (int x = startRow; x <= endRow; ++x) {
-        for (int y = startCol; y <= endCol; ++y) {
-            if ((*this)[x][y] == constants::OBSTACLE) continue;
-            positions.emplace_back(x, y);
-            auto it = startStats.find({x, y});
-            const double successRate = it != startStats.end() ? it->second.getSuccessRate() : 0.0;
-            weights.push_back(1.0 - successRate + epsilon);
-        }
-    }
-
-    // Weighted random selection
-    discrete_distribution<int> dist(weights.begin(), weights.end());
-    const auto idx = dist(rng);
-    return positions[idx];
+    // Weighted random selection: lower success rate = higher weight
+    return startStats.sample(rng);
 }
 
-tuple<int, int, int, double> Maze::performAction(const int rows, const int cols, const int x1, const int y1,
-                                                 const int action) const {
-    double reward = 0.0;
-    int changePos = 0;
-    int x2 = x1, y2 = y1;
-
-    // Perform the selected action
-    switch (action) {
-        case 0: // Move N
-            if (x1 > 0 && ((*this)[x1 - 1][y1] == constants::FREE_SPACE || (*this)[x1 - 1][y1] ==
-                           constants::CHARGING_STATION)) {
-                x2 = x1 - 1;
-                changePos = 1;
-            }
-            break;
-        case 1: // Move NE
-            if (x1 > 0 && y1 < cols - 1 && ((*this)[x1 - 1][y1 + 1] == constants::FREE_SPACE || (*this)[x1 - 1][y1 + 1]
-                                            == constants::CHARGING_STATION)) {
-                x2 = x1 - 1;
-                y2 = y1 + 1;
-                changePos = 1;
-            }
-            break;
-        case 2: // Move E
-            if (y1 < cols - 1 && ((*this)[x1][y1 + 1] == constants::FREE_SPACE || (*this)[x1][y1 + 1] ==
-                                  constants::CHARGING_STATION)) {
-                y2 = y1 + 1;
-                changePos = 1;
-            }
-            break;
-        case 3: // Move SE
-            if (x1 < rows - 1 && y1 < cols - 1 && (
-                    (*this)[x1 + 1][y1 + 1] == constants::FREE_SPACE || (*this)[x1 + 1][y1 + 1] ==
-                    constants::CHARGING_STATION)) {
-                x2 = x1 + 1;
-                y2 = y1 + 1;
-                changePos = 1;
-            }
-            break;
-        case 4: // Move S
-            if (x1 < rows - 1 && ((*this)[x1 + 1][y1] == constants::FREE_SPACE || (*this)[x1 + 1][y1] ==
-                                  constants::CHARGING_STATION)) {
-                x2 = x1 + 1;
-                changePos = 1;
-            }
-            break;
-        case 5: // Move SW
-            if (x1 < rows - 1 && y1 > 0 && ((*this)[x1 + 1][y1 - 1] == constants::FREE_SPACE || (*this)[x1 + 1][y1 - 1]
-                                            == constants::CHARGING_STATION)) {
-                x2 = x1 + 1;
-                y2 = y1 - 1;
-                changePos = 1;
-            }
-            break;
-        case 6: // Move W
-            if (y1 > 0 && ((*this)[x1][y1 - 1] == constants::FREE_SPACE || (*this)[x1][y1 - 1] ==
-                           constants::CHARGING_STATION)) {
-                y2 = y1 - 1;
-                changePos = 1;
-            }
-            break;
-        case 7: // Move NW
-            if (x1 > 0 && y1 > 0 && ((*this)[x1 - 1][y1 - 1] == constants::FREE_SPACE || (*this)[x1 - 1][y1 - 1] ==
-                                     constants::CHARGING_STATION)) {
-                x2 = x1 - 1;
-                y2 = y1 - 1;
-                changePos = 1;
-            }
-            break;
-        default:
-            changePos = 0;
-            break;
+tuple<int, int, int, double> Maze::performAction(const int x1, const int y1, const int action) const {
+    // Invalid actions leave the agent in place
+    if (action < 0 || action >= constants::ACTION_COUNT) {
+        return make_tuple(x1, y1, action, cell(x1, y1) == constants::CHARGING_STATION ? 100.0 : -10.0);
     }
+    const Transition &next = transition(x1, y1, action);
+    return make_tuple(next.row, next.col, action, next.reward);
+}
 
-    // Improved reward system
-    if ((*this)[x2][y2] == constants::CHARGING_STATION) {
-        reward = 100.0; // Large reward for reaching the goal
-    } else if (changePos == 0) {
-        reward = -10.0; // Stronger penalty for hitting obstacles
-    } else {
-        reward = -1.0; // Increased step penalty to encourage shorter paths
+void Maze::computeTransitions(const int row, const int col) {
+    for (int action = 0; action < constants::ACTION_COUNT; ++action) {
+        int changePos = 0;
+        int x2 = row, y2 = col;
+
+        // The obstacle border makes explicit bounds checks unnecessary
+        const int newX = row + constants::ROW_OFFSETS[action];
+        const int newY = col + constants::COL_OFFSETS[action];
+        if (cell(newX, newY) != constants::OBSTACLE) {
+            x2 = newX;
+            y2 = newY;
+            changePos = 1;
+        }
+
+        // Improved reward system
+        float reward;
+        if (cell(x2, y2) == constants::CHARGING_STATION) {
+            reward = 100.0f; // Large reward for reaching the goal
+        } else if (changePos == 0) {
+            reward = -10.0f; // Stronger penalty for hitting obstacles
+        } else {
+            reward = -1.0f; // Increased step penalty to encourage shorter paths
+        }
+
+        transitions[static_cast<size_t>(row * cols + col) * constants::ACTION_COUNT + action] = {
+            static_cast<int16_t>(x2), static_cast<int16_t>(y2), reward
+        };
     }
+}
 
-    return make_tuple(x2, y2, action, reward);
+void Maze::updateTransitionsAround(const int row, const int col) {
+    for (int x = max(0, row - 1); x <= min(rows - 1, row + 1); ++x) {
+        for (int y = max(0, col - 1); y <= min(cols - 1, col + 1); ++y) {
+            computeTransitions(x, y);
+        }
+    }
 }
 
 vector<pair<int, int> > Maze::getObstaclePositions() const {
     vector<pair<int, int> > obstaclePositions;
-    for (int i = 0; i < this->size(); ++i) {
-        for (int j = 0; j < (*this)[i].size(); ++j) {
-            if ((*this)[i][j] == constants::OBSTACLE) {
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            if (cell(i, j) == constants::OBSTACLE) {
                 obstaclePositions.emplace_back(i, j);
             }
         }
@@ -1,18 +1,37 @@
 #ifndef MAZE_H
 #define MAZE_H
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <random>
-#include <unordered_map>
+#include <span>
+#include <tuple>
 #include <vector>
 
 #include "constants.h"
-#include "hashpair.h"
+#include "rng.h"
 #include "startstats.h"
 
 using namespace std;
 
-class Maze : vector<vector<int> > {
+// Precomputed outcome of one action in one cell: the resulting position and the reward. Eight of these fill exactly one
+// cache line, so a step is a single indexed load.
+struct Transition {
+    int16_t row, col;
+    float reward;
+};
+
+// One cell update of a batch applied with Maze::applyChanges
+struct CellChange {
+    int row, col;
+    int value;
+};
+
+// Grid stored as one byte per cell in a flat buffer, surrounded by a one-cell border of obstacles so that neighbour
+// lookups never leave the buffer. operator() is the validated API for external callers, while cell() and the
+// index-based accessors are unchecked and meant for the hot paths (training, path search, A*).
+class Maze {
 public:
     Maze(int rows, int cols, double freeSpaceProb, double obstacleProb, double chargingStationProb);
 
@@ -20,6 +39,27 @@ public:
 
     void operator()(int row, int col, int value);
 
+    // Apply a batch of cell updates in place, in order, refreshing the transitions around every touched cell once.
+    // Returns the cells whose type differs after the batch, each with its type from before the batch.
+    vector<CellChange> applyChanges(span<const CellChange> changes);
+
+    // Unchecked access, (row, col) may lie at most one cell outside the maze (border cells are obstacles)
+    [[nodiscard]] int cell(const int row, const int col) const { return grid[index(row, col)]; }
+
+    // Index of (row, col) in the padded buffer
+    [[nodiscard]] int index(const int row, const int col) const { return (row + 1) * stride + col + 1; }
+
+    // Unchecked access by padded buffer index
+    [[nodiscard]] int cellAt(const int idx) const { return grid[idx]; }
+
+    // Distance between vertically adjacent cells in the padded buffer
+    [[nodiscard]] int getStride() const { return stride; }
+
+    // Precomputed transition for taking action in (row, col), row and col must lie inside the maze
+    [[nodiscard]] const Transition &transition(const int row, const int col, const int action) const {
+        return transitions[static_cast<size_t>(row * cols + col) * constants::ACTION_COUNT + action];
+    }
+
     void printMaze() const;
 
     [[nodiscard]] int getRows() const;
@@ -28,15 +68,28 @@ public:
 
     [[nodiscard]] bool checkExit(int x, int y) const;
 
-    [[nodiscard]] pair<int, int> selectFirstPlace(int startRow, int startCol, int endRow, int endCol) const;
+    [[nodiscard]] pair<int, int> selectFirstPlace(int startRow, int startCol, int endRow, int endCol, Rng &rng) const;
 
     pair<int, int> selectFirstPlace(int startRow, int startCol, int endRow, int endCol, int counter,
-                                    const unordered_map<pair<int, int>, StartStats, HashPair> &startStats,
-                                    mt19937 &rng) const;
+                                    const StartStatsGrid &startStats, Rng &rng) const;
 
-    [[nodiscard]] tuple<int, int, int, double> performAction(int rows, int cols, int x1, int y1, int action) const;
+    [[nodiscard]] tuple<int, int, int, double> performAction(int x1, int y1, int action) const;
 
     [[nodiscard]] vector<pair<int, int> > getObstaclePositions() const;
+
+private:
+    int rows, cols, stride;
+    vector<uint8_t> grid;
+    vector<Transition> transitions;
+
+    // Exit with an error if (row, col) lies outside the maze or value is not a cell type
+    void validateUpdate(int row, int col, int value) const;
+
+    // Recompute the transitions of all actions in (row, col)
+    void computeTransitions(int row, int col);
+
+    // Recompute the transitions affected by a change of (row, col): the cell itself and its eight neighbours
+    void updateTransitionsAround(int row, int col);
 };
 
 /***********************/
@@ -1,28 +1,84 @@
 #include "multiagent.h"
 
-void MultiAgent::fedAsynQ_EqAvg(TreeNode *node, const Maze &maze, const int tau, const int T, const int K) {
+namespace {
+    // Number of changed Q-table entries aggregated per pool task
+    constexpr int aggregationBlockSize = 512;
+
+    // Outcome of the first step of an agent's round, written by the agent into its own slot (no locking) and merged
+    // into the start statistics after the round
+    struct StartRecord {
+        int row, col;
+        bool success;
+    };
+
+    // Collect the Q-table entries updated by any agent during the round, each entry once
+    void collectChangedEntries(const vector<vector<int> > &updatedEntries, vector<unsigned> &stamps,
+                               const unsigned round, vector<int> &changedEntries) {
+        changedEntries.clear();
+        for (const vector<int> &entries: updatedEntries) {
+            for (const int entry: entries) {
+                if (stamps[entry] != round) {
+                    stamps[entry] = round;
+                    changedEntries.push_back(entry);
+                }
+            }
+        }
+    }
+
+    // Largest absolute entry of a Q-table, the difference to an all-zero Q-table
+    double maxAbsEntry(const Table<double> &table, const size_t entryCount) {
+        double maxValue = 0.0;
+        for (const double value: span(table.data(), entryCount)) {
+            maxValue = max(maxValue, abs(value));
+        }
+        return maxValue;
+    }
+
+    // Copy the new aggregated value of every changed entry into the local Q-tables. All other entries of the local
+    // Q-tables are still equal to the aggregate, so this replaces a full copy of the aggregated Q-table per agent.
+    void broadcastChangedEntries(const Table<double> &aggregatedQTable, vector<Table<double> > &localQTables,
+                                 const vector<int> &changedEntries) {
+        ThreadPool::getInstance().parallelFor(static_cast<int>(localQTables.size()), [&](const int k) {
+            double *localValues = localQTables[k].data();
+            const double *aggregatedValues = aggregatedQTable.data();
+            for (const int entry: changedEntries) {
+                localValues[entry] = aggregatedValues[entry];
+            }
+        });
+    }
+}
+
+void MultiAgent::fedAsynQ_EqAvg(TreeNode *node, const Maze &maze, const int tau, const int T, const int K,
+                                Rng &rng) {
     // Create aggregate Q-table
     const int localRows = node->endRow - node->startRow + 1;
     const int localCols = node->endCol - node->startCol + 1;
-    auto aggregatedQTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
-
-    // Create previous aggregate Q-table for convergence check
-    auto prevAggregatedQTable = aggregatedQTable;
 
     // Initialize the Q-table for the node (if not already initialized)
     node->initQTable();
 
+    // Aggregate Q-table, starts equal to the node's Q-table like the local ones
+    auto aggregatedQTable = *node->qTable;
+
     // Local Q-tables for each agent
     vector<Table<double> > localQTables(K, *node->qTable);
 
-    // Create a hash map for start statistics
-    unordered_map<pair<int, int>, StartStats, HashPair> startStats;
-    mutex statsMutex;
+    // Entries each agent updated during the current round, and their union
+    vector<vector<int> > updatedEntries(K);
+    vector<int> changedEntries;
+    vector<unsigned> changedStamps(static_cast<size_t>(localRows) * localCols * constants::ACTION_COUNT, 0);
+    unsigned round = 0;
+
+    // Dense per-cell start statistics, sampled through a Fenwick tree. Agents write their start outcomes into their own
+    // StartRecord slot and the slots are merged into the grid after each round.
+    StartStatsGrid startStats(maze, node->startRow, node->startCol, node->endRow, node->endCol);
+    vector<StartRecord> startRecords(K);
 
-    // Random number generators for each agent
-    vector<mt19937> rngs(K);
+    // Independent random number stream for each agent, derived from the node's stream
+    vector<Rng> rngs;
+    rngs.reserve(K);
     for (int i = 0; i < K; ++i) {
-        rngs[i].seed(random_device{}() + i);
+        rngs.push_back(rng.split());
     }
 
     // Create initial start positions for all agents
@@ -41,97 +97,89 @@ void MultiAgent::fedAsynQ_EqAvg(TreeNode *node, const Maze &maze, const int tau,
     // Loop for at most T iterations (ensuring that t + tau <= T to avoid iterations for which there will be no update)
     int t = 0;
     while (t + tau <= T) {
-        // Spawn threads for each agent
-        vector<thread> threads;
-        for (int k = 0; k < K; ++k) {
-            threads.emplace_back(
-                [&maze, &node, &agentPositions, &localQTables, &startStats, &statsMutex, epsilon, tau, k]() {
-                    pair<int, int> &agentPosition = agentPositions[k];
-                    Table<double> &localQTable = localQTables[k];
-                    int x1 = agentPosition.first, y1 = agentPosition.second;
-
-                    // Perform tau steps
-                    for (int step = 0; step < tau; ++step) {
-                        // Select and perform action
-                        vector<double> &qValues = localQTable(x1, y1, node->startRow, node->startCol);
-                        int act = node->selectAction(x1, y1, epsilon);
-
-                        int x2, y2, actionReward;
-                        tie(x2, y2, act, actionReward) = maze.performAction(node->rows, node->cols, x1, y1, act);
-
-                        // Update Q-value
-                        const vector<double> &nextQValues = localQTable(x2, y2, node->startRow, node->startCol);
-                        const double maxNextQ = *ranges::max_element(nextQValues);
-                        qValues[act] += constants::LEARNING_RATE * (
-                            actionReward + constants::DISCOUNT_FACTOR * maxNextQ - qValues[act]);
-
-                        // Update startStats
-                        if (step == 0) {
-                            lock_guard<mutex> lock(statsMutex);
-                            auto &stats = startStats[{x1, y1}];
-                            stats.incrementAttempts();
-                            if (maze.checkExit(x2, y2)) stats.incrementSuccesses();
-                        }
-
-                        // Move to next position
-                        x1 = x2;
-                        y1 = y2;
-                        agentPosition = {x1, y1};
+        // Run tau steps for every agent on the persistent thread pool, returns once all agents finished the round
+        ThreadPool::getInstance().parallelFor(
+            K, [&maze, &node, &agentPositions, &localQTables, &updatedEntries, &startRecords, &rngs, epsilon,
+                tau](const int k) {
+                pair<int, int> &agentPosition = agentPositions[k];
+                Table<double> &localQTable = localQTables[k];
+                Rng &agentRng = rngs[k];
+                vector<int> &agentUpdatedEntries = updatedEntries[k];
+                int x1 = agentPosition.first, y1 = agentPosition.second;
+
+                // Perform tau steps
+                for (int step = 0; step < tau; ++step) {
+                    // Select and perform action
+                    const span<double> qValues = localQTable(x1, y1, node->startRow, node->startCol);
+                    int act = node->selectAction(x1, y1, epsilon, agentRng);
+
+                    int x2, y2, actionReward;
+                    tie(x2, y2, act, actionReward) = maze.performAction(x1, y1, act);
+
+                    // Update Q-value
+                    const span<const double> nextQValues = localQTable(x2, y2, node->startRow, node->startCol);
+                    const double maxNextQ = *ranges::max_element(nextQValues);
+                    qValues[act] += constants::LEARNING_RATE * (
+                        actionReward + constants::DISCOUNT_FACTOR * maxNextQ - qValues[act]);
+                    agentUpdatedEntries.push_back(static_cast<int>(qValues.data() - localQTable.data()) + act);
+
+                    // Record the start for startStats
+                    if (step == 0) {
+                        startRecords[k] = {x1, y1, maze.checkExit(x2, y2)};
                     }
-                });
-        }
 
-        // Join threads to ensure all training is complete
-        for (thread &t: threads) {
-            if (t.joinable()) {
-                t.join();
-            }
-        }
+                    // Move to next position
+                    x1 = x2;
+                    y1 = y2;
+                    agentPosition = {x1, y1};
+                }
+            });
 
-        // Reset aggregated Q-table
-        aggregatedQTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
+        // Merge the agents' start records into the start statistics
+        for (const auto &[row, col, success]: startRecords) {
+            startStats.record(row, col, success);
+        }
 
         // Default alpha for averaging
         const double alpha = 1.0 / K;
 
-        // Aggregate Q-values from all local Q-tables
-        for (int k = 0; k < K; ++k) {
-            for (int row = node->startRow; row <= node->endRow; ++row) {
-                for (int col = node->startCol; col <= node->endCol; ++col) {
-                    vector<double> &aggregatedQValues = aggregatedQTable(row, col, node->startRow, node->startCol);
-                    vector<double> &localQValues = localQTables[k](row, col, node->startRow, node->startCol);
-                    for (int a = 0; a < constants::ACTION_COUNT; ++a) {
-                        aggregatedQValues[a] += alpha * localQValues[a];
-                    }
+        // The local Q-tables only differ from the previous aggregate in the entries the agents updated, so the average
+        // Q = Q_prev + alpha * sum_k (Q_k - Q_prev) only has to visit those. Blocks of them are reduced across all K
+        // local Q-tables in parallel, tracking the maximum entry-wise difference to the previous aggregate.
+        collectChangedEntries(updatedEntries, changedStamps, ++round, changedEntries);
+        const int changedCount = static_cast<int>(changedEntries.size());
+        const int blockCount = (changedCount + aggregationBlockSize - 1) / aggregationBlockSize;
+        vector<double> blockMaxDiff(blockCount, 0.0);
+        ThreadPool::getInstance().parallelFor(blockCount, [&](const int block) {
+            double *aggregatedValues = aggregatedQTable.data();
+            const int end = min(changedCount, (block + 1) * aggregationBlockSize);
+            for (int i = block * aggregationBlockSize; i < end; ++i) {
+                const int entry = changedEntries[i];
+                const double previous = aggregatedValues[entry];
+                double change = 0.0;
+                for (int k = 0; k < K; ++k) {
+                    change += alpha * (localQTables[k].data()[entry] - previous);
                 }
+                aggregatedValues[entry] = previous + change;
+                blockMaxDiff[block] = max(blockMaxDiff[block], abs(change));
             }
+        });
+        double maxDiff = 0.0;
+        for (const double diff: blockMaxDiff) {
+            maxDiff = max(maxDiff, diff);
         }
 
-        // Copy the aggregated Q-table back to the local Q-tables
-        for (int k = 0; k < K; ++k) {
-            localQTables[k] = aggregatedQTable;
+        // The previous aggregate of the first round is all zeros, not the node's incoming Q-values
+        if (round == 1) {
+            maxDiff = max(maxDiff, maxAbsEntry(aggregatedQTable, changedStamps.size()));
         }
 
-        // Compute the maximum difference entry-wise between the aggregated Q-table and the previous Q-table
-        double maxDiff = 0.0;
-        for (int row = node->startRow; row <= node->endRow; ++row) {
-            for (int col = node->startCol; col <= node->endCol; ++col) {
-                const vector<double> &currentQ = aggregatedQTable(row, col, node->startRow, node->startCol);
-                const vector<double> &prevQ = prevAggregatedQTable(row, col, node->startRow, node->startCol);
-
-                // Compute the difference for each action
-                for (int a = 0; a < constants::ACTION_COUNT; ++a) {
-                    double diff = abs(currentQ[a] - prevQ[a]);
-                    if (diff > maxDiff) {
-                        maxDiff = diff;
-                    }
-                }
-            }
+        // Bring the local Q-tables back in line with the aggregate
+        broadcastChangedEntries(aggregatedQTable, localQTables, changedEntries);
+        for (vector<int> &entries: updatedEntries) {
+            entries.clear();
         }
 
-        // Update the previous Q-table
-        prevAggregatedQTable = aggregatedQTable; // Copy current Q-values to previous
-
         // Select new start positions for all agents
         for (int k = 0; k < K; ++k) {
             // Randomly select a new start position within the node's bounds
@@ -149,32 +197,49 @@ void MultiAgent::fedAsynQ_EqAvg(TreeNode *node, const Maze &maze, const int tau,
     node->qTable = make_unique<Table<double> >(aggregatedQTable);
 }
 
-void MultiAgent::fedAsynQ_ImAvg(TreeNode *node, const Maze &maze, const int tau, const int T, const int K) {
+void MultiAgent::fedAsynQ_ImAvg(TreeNode *node, const Maze &maze, const int tau, const int T, const int K,
+                                Rng &rng) {
     // Create aggregate Q-table
     const int localRows = node->endRow - node->startRow + 1;
     const int localCols = node->endCol - node->startCol + 1;
-    auto aggregatedQTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
-
-    // Create previous aggregate Q-table for convergence check
-    auto prevAggregatedQTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
 
     // Initialize the Q-table for the node (if not already initialized)
     node->initQTable();
 
+    // Aggregate Q-table, starts equal to the node's Q-table like the local ones
+    auto aggregatedQTable = *node->qTable;
+
     // Local Q-tables for each agent
     vector<Table<double> > localQTables(K, *node->qTable);
 
-    // Create state-action counts for each agent
+    // Entries each agent updated during the current round, and their union
+    vector<vector<int> > updatedEntries(K);
+    vector<int> changedEntries;
+    vector<unsigned> changedStamps(static_cast<size_t>(localRows) * localCols * constants::ACTION_COUNT, 0);
+    unsigned round = 0;
+
+    // Create state-action counts for each agent (reused across rounds)
     auto stateActionCounts = vector<Table<int> >(K, Table<int>(localRows, localCols, constants::ACTION_COUNT));
 
-    // Create a hash map for start statistics
-    unordered_map<pair<int, int>, StartStats, HashPair> startStats;
-    mutex statsMutex;
+    // The importance weight of an agent with visit count n is (1 - LEARNING_RATE)^-n, which overflows for large n.
+    // Since alpha only depends on the ratio of the weights, they are taken relative to the largest count m of the
+    // entry instead: (1 - LEARNING_RATE)^(m - n), which lies in (0, 1]. Counts are bounded by tau, so all weights
+    // are precomputed.
+    vector<double> importanceWeights(tau + 1);
+    for (int d = 0; d <= tau; ++d) {
+        importanceWeights[d] = pow(1 - constants::LEARNING_RATE, d);
+    }
+
+    // Dense per-cell start statistics, sampled through a Fenwick tree. Agents write their start outcomes into their own
+    // StartRecord slot and the slots are merged into the grid after each round.
+    StartStatsGrid startStats(maze, node->startRow, node->startCol, node->endRow, node->endCol);
+    vector<StartRecord> startRecords(K);
 
-    // Random number generators for each agent
-    vector<mt19937> rngs(K);
+    // Independent random number stream for each agent, derived from the node's stream
+    vector<Rng> rngs;
+    rngs.reserve(K);
     for (int i = 0; i < K; ++i) {
-        rngs[i].seed(random_device{}() + i);
+        rngs.push_back(rng.split());
     }
 
     // Create initial start positions for all agents
@@ -193,130 +258,116 @@ void MultiAgent::fedAsynQ_ImAvg(TreeNode *node, const Maze &maze, const int tau,
     // Loop for T iterations
     int t = 0;
     while (t < T) {
-        // Spawn threads for each agent
-        vector<thread> threads;
-        for (int k = 0; k < K; ++k) {
-            threads.emplace_back(
-                [&maze, &node, &agentPositions, &localQTables, &stateActionCounts, &startStats, &statsMutex, epsilon,
-                    tau, k ]() {
-                    pair<int, int> &agentPosition = agentPositions[k];
-                    Table<double> &localQTable = localQTables[k];
-
-                    // Wrong initialization, but used to avoid compiler errors
-                    Table<int> &stateActionTable = stateActionCounts[k];
-                    int x1 = agentPosition.first, y1 = agentPosition.second;
-
-                    // Perform tau steps
-                    for (int step = 0; step < tau; ++step) {
-                        // Select and perform action
-                        vector<double> &qValues = localQTable(x1, y1, node->startRow, node->startCol);
-                        int act = node->selectAction(x1, y1, epsilon);
-
-                        int x2, y2, actionReward;
-                        tie(x2, y2, act, actionReward) = maze.performAction(node->rows, node->cols, x1, y1, act);
-
-                        // Update the state-action count
-                        vector<int> &actionCounts = stateActionTable(x1, y1, node->startRow, node->startCol);
-                        actionCounts[act] += 1; // Increment action count for this state
-
-                        // Update Q-value
-                        const vector<double> &nextQValues = localQTable(x2, y2, node->startRow, node->startCol);
-                        const double maxNextQ = *ranges::max_element(nextQValues);
-                        qValues[act] += constants::LEARNING_RATE * (
-                            actionReward + constants::DISCOUNT_FACTOR * maxNextQ - qValues[act]);
-
-                        // Update startStats
-                        if (step == 0) {
-                            lock_guard<mutex> lock(statsMutex);
-                            auto &stats = startStats[{x1, y1}];
-                            stats.incrementAttempts();
-                            if (maze.checkExit(x2, y2)) stats.incrementSuccesses();
-                        }
-
-                        // Move to next position
-                        x1 = x2;
-                        y1 = y2;
-                        agentPosition = {x1, y1};
+        // Run tau steps for every agent on the persistent thread pool, returns once all agents finished the round
+        ThreadPool::getInstance().parallelFor(
+            K, [&maze, &node, &agentPositions, &localQTables, &stateActionCounts, &updatedEntries, &startRecords,
+                &rngs, epsilon, tau](const int k) {
+                pair<int, int> &agentPosition = agentPositions[k];
+                Table<double> &localQTable = localQTables[k];
+                Rng &agentRng = rngs[k];
+                vector<int> &agentUpdatedEntries = updatedEntries[k];
+
+                // Wrong initialization, but used to avoid compiler errors
+                Table<int> &stateActionTable = stateActionCounts[k];
+                int x1 = agentPosition.first, y1 = agentPosition.second;
+
+                // Perform tau steps
+                for (int step = 0; step < tau; ++step) {
+                    // Select and perform action
+                    const span<double> qValues = localQTable(x1, y1, node->startRow, node->startCol);
+                    int act = node->selectAction(x1, y1, epsilon, agentRng);
+
+                    int x2, y2, actionReward;
+                    tie(x2, y2, act, actionReward) = maze.performAction(x1, y1, act);
+
+                    // Update the state-action count
+                    const span<int> actionCounts = stateActionTable(x1, y1, node->startRow, node->startCol);
+                    actionCounts[act] += 1; // Increment action count for this state
+
+                    // Update Q-value
+                    const span<const double> nextQValues = localQTable(x2, y2, node->startRow, node->startCol);
+                    const double maxNextQ = *ranges::max_element(nextQValues);
+                    qValues[act] += constants::LEARNING_RATE * (
+                        actionReward + constants::DISCOUNT_FACTOR * maxNextQ - qValues[act]);
+                    agentUpdatedEntries.push_back(static_cast<int>(qValues.data() - localQTable.data()) + act);
+
+                    // Record the start for startStats
+                    if (step == 0) {
+                        startRecords[k] = {x1, y1, maze.checkExit(x2, y2)};
                     }
-                });
-        }
 
-        // Join threads to ensure all training is complete
-        for (thread &t: threads) {
-            if (t.joinable()) {
-                t.join();
-            }
-        }
-
-        // Reset aggregated Q-table
-        aggregatedQTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
+                    // Move to next position
+                    x1 = x2;
+                    y1 = y2;
+                    agentPosition = {x1, y1};
+                }
+            });
 
-        // Create denominator table for computation of alpha
-        auto denominatorTable = Table<double>(localRows, localCols, constants::ACTION_COUNT);
+        // Merge the agents' start records into the start statistics
+        for (const auto &[row, col, success]: startRecords) {
+            startStats.record(row, col, success);
+        }
 
-        // Compute the denominator for each position in the local Q-tables
-        for (int k = 0; k < K; ++k) {
-            for (int row = node->startRow; row <= node->endRow; ++row) {
-                for (int col = node->startCol; col <= node->endCol; ++col) {
-                    vector<double> &denominator = denominatorTable(row, col, node->startRow, node->startCol);
-                    const vector<int> &actionCounts = stateActionCounts[k](row, col, node->startRow, node->startCol);
-                    for (int a = 0; a < constants::ACTION_COUNT; ++a) {
-                        denominator[a] += pow(1 - constants::LEARNING_RATE, -1.0 * actionCounts[a]);
-                    }
+        // The local Q-tables only differ from the previous aggregate in the entries the agents updated (all other
+        // entries have zero visit counts, so alpha = 1/K), so the weighted average
+        // Q = Q_prev + sum_k alpha_k * (Q_k - Q_prev) only has to visit those. Blocks of them are reduced across all K
+        // local Q-tables in parallel, tracking the maximum entry-wise difference to the previous aggregate.
+        collectChangedEntries(updatedEntries, changedStamps, ++round, changedEntries);
+        const int changedCount = static_cast<int>(changedEntries.size());
+        const int blockCount = (changedCount + aggregationBlockSize - 1) / aggregationBlockSize;
+        vector<double> blockMaxDiff(blockCount, 0.0);
+        ThreadPool::getInstance().parallelFor(blockCount, [&](const int block) {
+            double *aggregatedValues = aggregatedQTable.data();
+            const int end = min(changedCount, (block + 1) * aggregationBlockSize);
+            for (int i = block * aggregationBlockSize; i < end; ++i) {
+                const int entry = changedEntries[i];
+                const double previous = aggregatedValues[entry];
+
+                // Weights relative to the largest visit count of this entry (see importanceWeights)
+                int maxCount = 0;
+                for (int k = 0; k < K; ++k) {
+                    maxCount = max(maxCount, stateActionCounts[k].data()[entry]);
                 }
-            }
-        }
 
-        // Default alpha for averaging
-        double alpha = 1.0 / K;
+                // Compute the denominator of alpha for this entry
+                double denominator = 0.0;
+                for (int k = 0; k < K; ++k) {
+                    denominator += importanceWeights[maxCount - stateActionCounts[k].data()[entry]];
+                }
 
-        // Aggregate Q-values from all local Q-tables
-        for (int k = 0; k < K; ++k) {
-            for (int row = node->startRow; row <= node->endRow; ++row) {
-                for (int col = node->startCol; col <= node->endCol; ++col) {
-                    vector<double> &aggregatedQValues = aggregatedQTable(row, col, node->startRow, node->startCol);
-                    vector<double> &localQValues = localQTables[k](row, col, node->startRow, node->startCol);
-
-                    // Compute alpha based on the mode
-                    const vector<double> &denominator = denominatorTable(row, col, node->startRow, node->startCol);
-                    const vector<int> &actionCounts = stateActionCounts[k](row, col, node->startRow, node->startCol);
-                    for (int a = 0; a < constants::ACTION_COUNT; ++a) {
-                        double nominator = pow(1 - constants::LEARNING_RATE, -1.0 * actionCounts[a]);
-                        alpha = nominator / denominator[a]; // Compute alpha
-                        aggregatedQValues[a] += alpha * localQValues[a];
-                    }
+                double change = 0.0;
+                for (int k = 0; k < K; ++k) {
+                    // Compute alpha based on the visit counts
+                    const double nominator = importanceWeights[maxCount - stateActionCounts[k].data()[entry]];
+                    const double alpha = nominator / denominator;
+                    change += alpha * (localQTables[k].data()[entry] - previous);
                 }
+                aggregatedValues[entry] = previous + change;
+                blockMaxDiff[block] = max(blockMaxDiff[block], abs(change));
             }
+        });
+        double maxDiff = 0.0;
+        for (const double diff: blockMaxDiff) {
+            maxDiff = max(maxDiff, diff);
         }
 
-        // Copy the aggregated Q-table back to the local Q-tables
-        for (int k = 0; k < K; ++k) {
-            localQTables[k] = aggregatedQTable;
+        // The previous aggregate of the first round is all zeros, not the node's incoming Q-values
+        if (round == 1) {
+            maxDiff = max(maxDiff, maxAbsEntry(aggregatedQTable, changedStamps.size()));
         }
 
-        // Compute the maximum difference entry-wise between the aggregated Q-table and the previous Q-table
-        double maxDiff = 0.0;
-        for (int row = node->startRow; row <= node->endRow; ++row) {
-            for (int col = node->startCol; col <= node->endCol; ++col) {
-                const vector<double> &currentQ = aggregatedQTable(row, col, node->startRow, node->startCol);
-                const vector<double> &prevQ = prevAggregatedQTable(row, col, node->startRow, node->startCol);
-
-                // Compute the difference for each action
-                for (int a = 0; a < constants::ACTION_COUNT; ++a) {
-                    double diff = abs(currentQ[a] - prevQ[a]);
-                    if (diff > maxDiff) {
-                        maxDiff = diff;
-                    }
-                }
+        // Bring the local Q-tables back in line with the aggregate
+        broadcastChangedEntries(aggregatedQTable, localQTables, changedEntries);
+
+        // Reset state-action counts for the next iteration (only the entries the agent visited are non-zero)
+        for (int k = 0; k < K; ++k) {
+            int *counts = stateActionCounts[k].data();
+            for (const int entry: updatedEntries[k]) {
+                counts[entry] = 0;
             }
+            updatedEntries[k].clear();
         }
 
-        // Update the previous Q-table
-        prevAggregatedQTable = aggregatedQTable; // Copy current Q-values to previous
-
-        // Reset state-action counts for the next iteration
-        stateActionCounts = vector<Table<int> >(K, Table<int>(localRows, localCols, constants::ACTION_COUNT));
-
         // Select new start positions for all agents
         for (int k = 0; k < K; ++k) {
             // Randomly select a new start position within the node's bounds
@@ -0,0 +1,235 @@
+#include "policyevaluator.h"
+
+#include "threadpool.h"
+#include "treenode.h"
+
+void PolicyEvaluator::invalidate(const int startRow, const int startCol, const int endRow, const int endCol) {
+    lock_guard<mutex> lock(dirtyMutex);
+    dirtyRegions.push_back({startRow, startCol, endRow, endCol});
+}
+
+void PolicyEvaluator::cellsChanged(const vector<pair<int, int> > &changedCells) {
+    lock_guard<mutex> lock(dirtyMutex);
+    if (!evaluated) return; // The first evaluation reads the whole maze
+    this->changedCells.insert(this->changedCells.end(), changedCells.begin(), changedCells.end());
+}
+
+void PolicyEvaluator::refresh(const TreeNode &root) {
+    const Maze &maze = *root.maze;
+    if (!evaluated || rows != root.rows || cols != root.cols) {
+        rebuild(root);
+        return;
+    }
+
+    vector<array<int, 4> > regions;
+    vector<pair<int, int> > changed;
+    {
+        lock_guard<mutex> lock(dirtyMutex);
+        swap(regions, dirtyRegions);
+        swap(changed, changedCells);
+    }
+
+    // Collect the cells whose links may have changed: cells with changed Q-values, changed cells and their neighbours
+    nextGeneration();
+    vector<int> dirty;
+    auto markDirty = [this, &dirty](const int cell) {
+        if (stamps[cell] != generation) {
+            stamps[cell] = generation;
+            dirty.push_back(cell);
+        }
+    };
+    for (const auto &[startRow, startCol, endRow, endCol]: regions) {
+        for (int x = startRow; x <= endRow; ++x) {
+            for (int y = startCol; y <= endCol; ++y) {
+                markDirty(x * cols + y);
+            }
+        }
+    }
+    for (const auto &[x, y]: changed) {
+        markDirty(x * cols + y);
+        for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+            const int newX = x + constants::ROW_OFFSETS[i];
+            const int newY = y + constants::COL_OFFSETS[i];
+            if (newX >= 0 && newX < rows && newY >= 0 && newY < cols) {
+                markDirty(newX * cols + newY);
+            }
+        }
+    }
+    if (dirty.empty()) return;
+    const int cellCount = rows * cols;
+    if (dirty.size() > static_cast<size_t>(cellCount) / 4) {
+        rebuild(root);
+        return;
+    }
+
+    // Search backwards over the old links for the cells whose search reaches a dirty cell before it ends. The search
+    // from a cell expands the cells up to its distance (or up to maxSteps - 1 when it failed), other cells keep their
+    // result. A cell that is not affected cannot make its predecessors affected either, so it is not expanded.
+    nextGeneration();
+    vector<int> toExplore;
+    for (const int cell: dirty) {
+        stamps[cell] = generation;
+        searchDepths[cell] = 0;
+        toExplore.push_back(cell);
+    }
+    vector<int> affected;
+    for (size_t next = 0; next < toExplore.size(); ++next) {
+        const int cell = toExplore[next];
+        const int depth = searchDepths[cell];
+        if (depth > (distances[cell] >= 0 ? distances[cell] : maxSteps - 1)) continue;
+        affected.push_back(cell);
+        if (depth + 1 >= maxSteps) continue;
+
+        const int x = cell / cols, y = cell % cols;
+        for (unsigned mask = predecessorMasks[cell]; mask; mask &= mask - 1) {
+            const int i = countr_zero(mask);
+            const int predecessor = (x - constants::ROW_OFFSETS[i]) * cols + (y - constants::COL_OFFSETS[i]);
+            if (stamps[predecessor] != generation) {
+                stamps[predecessor] = generation;
+                searchDepths[predecessor] = depth + 1;
+                toExplore.push_back(predecessor);
+            }
+        }
+    }
+
+    // Relink the dirty cells in the current maze
+    for (const int cell: dirty) {
+        unlinkSuccessors(cell);
+        cells[cell] = maze.cell(cell / cols, cell % cols);
+    }
+    for (const int cell: dirty) {
+        linkSuccessors(root, cell);
+    }
+
+    // Evaluate the affected cells again, in chunks on the shared thread pool
+    if (affected.size() > static_cast<size_t>(cellCount) / 4) {
+        computeAllDistances();
+        return;
+    }
+    constexpr int chunkSize = 64;
+    const int chunkCount = static_cast<int>((affected.size() + chunkSize - 1) / chunkSize);
+    ThreadPool::getInstance().parallelFor(chunkCount, [&](const int chunk) {
+        for (size_t i = chunk * chunkSize; i < min(affected.size(), static_cast<size_t>(chunk + 1) * chunkSize); ++i) {
+            const int cell = affected[i];
+            if (cells[cell] == constants::OBSTACLE) {
+                distances[cell] = -1;
+                continue;
+            }
+            const auto [success, steps] = root.findValidPath(cell / cols, cell % cols, maxSteps);
+            distances[cell] = success ? steps : -1;
+        }
+    });
+}
+
+const vector<int> &PolicyEvaluator::getDistances() const {
+    return distances;
+}
+
+double PolicyEvaluator::getSuccessRate(const int startRow, const int startCol, const int endRow,
+                                       const int endCol) const {
+    int totalPositions = 0;
+    int successfulPaths = 0;
+    for (int x = startRow; x <= endRow; ++x) {
+        for (int y = startCol; y <= endCol; ++y) {
+            if (cells[x * cols + y] == constants::OBSTACLE) continue; // Skip obstacles
+            totalPositions++;
+            successfulPaths += distances[x * cols + y] >= 0;
+        }
+    }
+    return totalPositions > 0 ? static_cast<double>(successfulPaths) / totalPositions : 0.0;
+}
+
+void PolicyEvaluator::rebuild(const TreeNode &root) {
+    const Maze &maze = *root.maze;
+    rows = root.rows;
+    cols = root.cols;
+    maxSteps = rows + cols; // Consistent with testAgent
+    const size_t cellCount = static_cast<size_t>(rows) * cols;
+    {
+        lock_guard<mutex> lock(dirtyMutex);
+        dirtyRegions.clear();
+        changedCells.clear();
+    }
+
+    cells.resize(cellCount);
+    for (int x = 0; x < rows; ++x) {
+        for (int y = 0; y < cols; ++y) {
+            cells[x * cols + y] = maze.cell(x, y);
+        }
+    }
+    successors.assign(2 * cellCount, -1);
+    predecessorMasks.assign(cellCount, 0);
+    for (int cell = 0; cell < static_cast<int>(cellCount); ++cell) {
+        linkSuccessors(root, cell);
+    }
+    searchDepths.resize(cellCount);
+    if (stamps.size() != cellCount) {
+        stamps.assign(cellCount, 0);
+        generation = 0;
+    }
+    computeAllDistances();
+    evaluated = true;
+}
+
+void PolicyEvaluator::linkSuccessors(const TreeNode &root, const int cell) {
+    const int x = cell / cols, y = cell % cols;
+    if (cells[cell] == constants::OBSTACLE) return;
+
+    const auto [first, second] = root.selectTopTwoActions(x, y);
+    const int actions[2] = {first, second};
+    for (int k = 0; k < 2; ++k) {
+        if (actions[k] < 0) continue;
+        const int newX = x + constants::ROW_OFFSETS[actions[k]];
+        const int newY = y + constants::COL_OFFSETS[actions[k]];
+        if (root.maze->cell(newX, newY) == constants::OBSTACLE) continue;
+        successors[2 * cell + k] = static_cast<int8_t>(actions[k]);
+        predecessorMasks[newX * cols + newY] |= 1u << actions[k];
+    }
+}
+
+void PolicyEvaluator::unlinkSuccessors(const int cell) {
+    const int x = cell / cols, y = cell % cols;
+    for (int k = 0; k < 2; ++k) {
+        const int act = successors[2 * cell + k];
+        if (act < 0) continue;
+        const int next = (x + constants::ROW_OFFSETS[act]) * cols + (y + constants::COL_OFFSETS[act]);
+        predecessorMasks[next] &= ~(1u << act);
+        successors[2 * cell + k] = -1;
+    }
+}
+
+void PolicyEvaluator::computeAllDistances() {
+    // The forward search of findValidPath finds the nearest station along the links, so the distances of a backward
+    // search from all stations at once match it for every start cell
+    distances.assign(cells.size(), -1);
+    vector<int> toExplore;
+    toExplore.reserve(cells.size());
+    for (int cell = 0; cell < static_cast<int>(cells.size()); ++cell) {
+        if (cells[cell] == constants::CHARGING_STATION) {
+            distances[cell] = 0;
+            toExplore.push_back(cell);
+        }
+    }
+    for (size_t next = 0; next < toExplore.size(); ++next) {
+        const int cell = toExplore[next];
+        if (distances[cell] + 1 >= maxSteps) continue;
+
+        const int x = cell / cols, y = cell % cols;
+        for (unsigned mask = predecessorMasks[cell]; mask; mask &= mask - 1) {
+            const int i = countr_zero(mask);
+            const int predecessor = (x - constants::ROW_OFFSETS[i]) * cols + (y - constants::COL_OFFSETS[i]);
+            if (distances[predecessor] < 0) {
+                distances[predecessor] = distances[cell] + 1;
+                toExplore.push_back(predecessor);
+            }
+        }
+    }
+}
+
+void PolicyEvaluator::nextGeneration() {
+    if (++generation == 0) {
+        // Stamps wrapped around, start over
+        ranges::fill(stamps, 0);
+        generation = 1;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef POLICYEVALUATOR_H
+#define POLICYEVALUATOR_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+class TreeNode;
+
+// Results of the greedy policy search (findValidPath from every free cell) over the whole map of a root node. Every
+// free cell links to its top 2 greedy successors, and every cell keeps a mask of the neighbours linking to it, so the
+// reversed links double as a reverse dependency index: after Q-value or obstacle changes only the cells whose search
+// can pass through a changed cell are evaluated again.
+class PolicyEvaluator {
+public:
+    // Mark the Q-values of a region as changed, safe to call from training threads
+    void invalidate(int startRow, int startCol, int endRow, int endCol);
+
+    // Mark cells whose type changed in the root's maze, reported by TreeNode::applyMazeChanges
+    void cellsChanged(const vector<pair<int, int> > &changedCells);
+
+    // Bring the results up to date with the root's Q-table and maze. Changes since the previous evaluation have to be
+    // reported through invalidate (Q-values) and cellsChanged (cell types).
+    void refresh(const TreeNode &root);
+
+    // Steps to a charging station per cell (row-major), -1 for obstacles and cells without a path within maxSteps
+    [[nodiscard]] const vector<int> &getDistances() const;
+
+    // Fraction of the free cells of a region that reach a charging station
+    [[nodiscard]] double getSuccessRate(int startRow, int startCol, int endRow, int endCol) const;
+
+private:
+    int rows = 0, cols = 0, maxSteps = 0;
+    bool evaluated = false;
+    vector<uint8_t> cells; // Cell types of the evaluated maze
+    vector<int8_t> successors; // Per cell, the actions of its two successor links (-1 if missing)
+    vector<uint8_t> predecessorMasks; // Per cell, bit i is set if the neighbour at -offset i links to it by action i
+    vector<int> distances;
+    vector<int> searchDepths; // Scratch space of the dependency search
+    vector<uint32_t> stamps;
+    uint32_t generation = 0;
+    mutex dirtyMutex;
+    vector<array<int, 4> > dirtyRegions; // Regions with changed Q-values (guarded by dirtyMutex)
+    vector<pair<int, int> > changedCells; // Cells with changed types (guarded by dirtyMutex)
+
+    // Evaluate every cell from scratch
+    void rebuild(const TreeNode &root);
+
+    // Link a cell to its top 2 greedy successors in the current maze
+    void linkSuccessors(const TreeNode &root, int cell);
+
+    void unlinkSuccessors(int cell);
+
+    // Breadth-first search backwards from all charging stations over the links
+    void computeAllDistances();
+
+    // Start a new generation of stamps
+    void nextGeneration();
+};
+
+#endif //POLICYEVALUATOR_H
@@ -0,0 +1,27 @@
+#include "rng.h"
+
+namespace {
+    // SplitMix64, used to expand a seed into the generator state
+    uint64_t splitMix64(uint64_t &x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+}
+
+Rng::Rng(const uint64_t seed) : Rng(seed, 0) {
+}
+
+Rng::Rng(const uint64_t seed, const uint64_t stream) {
+    uint64_t x = seed;
+    uint64_t mixedStream = stream;
+    x ^= splitMix64(mixedStream);
+    for (uint64_t &s: state) {
+        s = splitMix64(x);
+    }
+}
+
+Rng Rng::split() {
+    return {(*this)(), (*this)()};
+}
@@ -0,0 +1,56 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+#include <limits>
+
+using namespace std;
+
+// xoshiro256** generator. Every thread owns its own stream, so there is no shared state (unlike rand()) and a run is
+// reproducible from a single master seed. Satisfies UniformRandomBitGenerator, so it works with <random>
+// distributions.
+class Rng {
+public:
+    using result_type = uint64_t;
+
+    explicit Rng(uint64_t seed);
+
+    // Stream derived from a master seed and a stream id
+    Rng(uint64_t seed, uint64_t stream);
+
+    static constexpr result_type min() { return 0; }
+
+    static constexpr result_type max() { return numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform integer in [0, bound)
+    int nextInt(const int bound) {
+        return static_cast<int>(((*this)() >> 32) * static_cast<uint64_t>(bound) >> 32);
+    }
+
+    // Uniform double in [0, 1)
+    double nextDouble() {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // Create a new independent stream seeded from this one
+    Rng split();
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(const uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+#endif //RNG_H
@@ -1,16 +1,102 @@
 #include "singleagent.h"
 
-Experience::Experience(const int x1, const int y1, int const action, const double reward, const int x2,
-                       const int y2) : x1(x1), y1(y1), action(action), reward(reward), x2(x2), y2(y2) {
+QChangeTracker::QChangeTracker(const Table<double> &qTable, const int startRow, const int startCol) : qTable(qTable),
+    startRow(startRow), startCol(startCol), epoch(1),
+    stamps(static_cast<size_t>(qTable.getRows()) * qTable.getCols() * qTable.getActions(), 0),
+    windowStart(stamps.size()) {
 }
 
-tuple<int, int, int, double, int, int> Experience::getValues() const {
-    return make_tuple(x1, y1, action, reward, x2, y2);
+void QChangeTracker::record(const int x, const int y, const int action) {
+    const int idx = static_cast<int>(qTable(x, y, startRow, startCol).data() - qTable.data()) + action;
+    if (stamps[idx] != epoch) {
+        stamps[idx] = epoch;
+        windowStart[idx] = qTable.data()[idx];
+        touched.push_back(idx);
+    }
+}
+
+double QChangeTracker::getMaxChange() const {
+    const double *values = qTable.data();
+    double maxChange = 0.0;
+    for (const int idx: touched) {
+        maxChange = max(maxChange, fabs(values[idx] - windowStart[idx]));
+    }
+    return maxChange;
+}
+
+void QChangeTracker::reset() {
+    epoch++;
+    touched.clear();
+}
+
+namespace {
+    // Prioritized replay parameters: priority = (|TD-error| + offset)^exponent
+    constexpr double priorityExponent = 0.6;
+    constexpr double priorityOffset = 1e-3;
+}
+
+ReplayBuffer::ReplayBuffer(const int capacity, const bool prioritized) : capacity(capacity), head(0), count(0),
+                                                                         prioritized(prioritized), x1s(capacity),
+                                                                         y1s(capacity), actions(capacity),
+                                                                         x2s(capacity), y2s(capacity),
+                                                                         rewards(capacity),
+                                                                         priorities(prioritized ? capacity : 1),
+                                                                         maxPriority(1.0) {
+}
+
+void ReplayBuffer::push(const int x1, const int y1, const int action, const double reward, const int x2,
+                        const int y2) {
+    x1s[head] = x1;
+    y1s[head] = y1;
+    actions[head] = action;
+    rewards[head] = reward;
+    x2s[head] = x2;
+    y2s[head] = y2;
+
+    // New experiences get the highest priority seen so far, so they are replayed at least once
+    if (prioritized) priorities.update(head, maxPriority);
+
+    head = head + 1 == capacity ? 0 : head + 1;
+    count = min(count + 1, capacity);
+}
+
+int ReplayBuffer::size() const {
+    return count;
 }
 
-SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const int rows, const int cols,
-                                         const int startRow, const int startCol, const int endRow, const int endCol,
-                                         const int maxStepsPerEpisode) {
+void ReplayBuffer::replay(const TreeNode *node, const int batchSize, Rng &rng, QChangeTracker &tracker) {
+    // Draw all indices first, then apply the updates in order (same result as sampling one at a time)
+    batch.resize(batchSize);
+    if (!prioritized) {
+        for (int &idx: batch) {
+            idx = rng.nextInt(count);
+        }
+        for (const int idx: batch) {
+            tracker.record(x1s[idx], y1s[idx], actions[idx]);
+            node->updateQTable(x1s[idx], y1s[idx], actions[idx], rewards[idx], x2s[idx], y2s[idx]);
+        }
+        return;
+    }
+
+    // Stratified proportional sampling: one draw from each of batchSize equal slices of the total priority
+    const double segment = priorities.getTotal() / batchSize;
+    for (int i = 0; i < batchSize; ++i) {
+        batch[i] = min(priorities.find((i + rng.nextDouble()) * segment), count - 1);
+    }
+
+    // Apply the updates and refresh the priorities with the new TD-errors
+    for (const int idx: batch) {
+        tracker.record(x1s[idx], y1s[idx], actions[idx]);
+        const double tdError = node->updateQTable(x1s[idx], y1s[idx], actions[idx], rewards[idx], x2s[idx], y2s[idx]);
+        const double priority = pow(fabs(tdError) + priorityOffset, priorityExponent);
+        priorities.update(idx, priority);
+        maxPriority = max(maxPriority, priority);
+    }
+}
+
+SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const int startRow, const int startCol,
+                                         const int endRow, const int endCol, const int maxStepsPerEpisode, Rng &rng,
+                                         const bool prioritizedReplay) {
     int arrival = 0, x2, y2, iteration = 0, counter = 0, stableEpisodes = 0;
     double actionReward = 0;
     bool converged = false;
@@ -18,8 +104,8 @@ SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const
     // Initialize Q-table if not already done
     node->initQTable();
 
-    // Store previous Q-table state for convergence check
-    auto prevQTable = *node->qTable;
+    // Track Q-value changes for the convergence check
+    QChangeTracker tracker(*node->qTable, startRow, startCol);
 
     // Convergence parameters
     double epsilon = 1.0;
@@ -29,14 +115,12 @@ SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const
     constexpr int minEpisodes = 500;
 
     // Experience replay buffer
-    vector<Experience> replayBuffer;
     constexpr int bufferSize = 1000;
-    replayBuffer.reserve(bufferSize);
+    ReplayBuffer replayBuffer(bufferSize, prioritizedReplay);
     constexpr int batchSize = 64;
 
     // Track starting position success
-    unordered_map<pair<int, int>, StartStats, HashPair> startStats;
-    mt19937 rng(random_device{}());
+    StartStatsGrid startStats(maze, startRow, startCol, endRow, endCol);
 
     // Main training loop
     while (!converged && counter < constants::EPISODE_COUNT) {
@@ -46,21 +130,17 @@ SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const
         // Reset episode
         while (arrival == 0 && iteration < maxStepsPerEpisode) {
             // Select action using epsilon-greedy policy and perform it
-            int act = node->selectAction(x1, y1, epsilon);
-            tie(x2, y2, act, actionReward) = maze.performAction(rows, cols, x1, y1, act);
+            int act = node->selectAction(x1, y1, epsilon, rng);
+            tie(x2, y2, act, actionReward) = maze.performAction(x1, y1, act);
 
             // Store experience in replay buffer and update Q-table
-            replayBuffer.push_back({x1, y1, act, actionReward, x2, y2});
-            if (replayBuffer.size() > bufferSize) replayBuffer.erase(replayBuffer.begin());
+            replayBuffer.push(x1, y1, act, actionReward, x2, y2);
+            tracker.record(x1, y1, act);
             node->updateQTable(x1, y1, act, actionReward, x2, y2);
 
             // Perform experience replay
             if (replayBuffer.size() >= batchSize && counter > minEpisodes) {
-                for (int i = 0; i < batchSize; i++) {
-                    const int idx = rand() % replayBuffer.size();
-                    const auto &[x1, y1, action, reward, x2, y2] = replayBuffer[idx].getValues();
-                    node->updateQTable(x1, y1, action, reward, x2, y2);
-                }
+                replayBuffer.replay(node, batchSize, rng, tracker);
             }
             arrival = maze.checkExit(x2, y2);
             x1 = x2;
@@ -73,20 +153,8 @@ SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const
 
         // Check for convergence every 50 episodes
         if (counter % 50 == 0 && counter >= minEpisodes) {
-            Table<double> &qTable = *node->qTable;
-            double maxChange = 0.0;
-            for (int row = node->startRow; row <= node->endRow; row++) {
-                for (int col = node->startCol; col <= node->endCol; col++) {
-                    // Get Q-values for the current position
-                    vector<double> &qValues = qTable(row, col, startRow, startCol);
-                    vector<double> &prevQValues = prevQTable(row, col, startRow, startCol);
-
-                    // Calculate maximum change compared to previous Q-table
-                    for (int a = 0; a < constants::ACTION_COUNT; a++) {
-                        maxChange = max(maxChange, fabs(qValues[a] - prevQValues[a]));
-                    }
-                }
-            }
+            // Maximum change compared to the Q-values at the previous check
+            const double maxChange = tracker.getMaxChange();
 
             // Check for convergence
             if (maxChange < threshold && stableEpisodes >= patience) {
@@ -96,7 +164,7 @@ SingleAgentTraining::SingleAgentTraining(TreeNode *node, const Maze &maze, const
             } else {
                 stableEpisodes = 0;
             }
-            prevQTable = *node->qTable;
+            tracker.reset();
         }
         counter++;
     }
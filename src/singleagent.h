@@ -1,24 +1,61 @@
 #ifndef SINGLEAGENT_H
 #define SINGLEAGENT_H
 
+#include "sumtree.h"
 #include "treenode.h"
 
-class Experience {
+// Tracks the net change of Q-values over a convergence window without snapshotting the whole table: the value of an
+// entry is saved the first time it is updated in the window, so a check only visits the entries that were updated
+class QChangeTracker {
 public:
-    Experience(int x1, int y1, int action, double reward, int x2, int y2);
+    QChangeTracker(const Table<double> &qTable, int startRow, int startCol);
 
-    [[nodiscard]] tuple<int, int, int, double, int, int> getValues() const;
+    // Call before updating the Q-value of (x, y, action)
+    void record(int x, int y, int action);
+
+    // Largest absolute change of any entry since the window started
+    [[nodiscard]] double getMaxChange() const;
+
+    // Start a new window
+    void reset();
+
+private:
+    const Table<double> &qTable;
+    int startRow, startCol;
+    unsigned epoch;
+    vector<unsigned> stamps; // Window in which each entry was last saved
+    vector<double> windowStart; // Value of each entry at the start of its window
+    vector<int> touched; // Entries updated in the current window
+};
+
+// Fixed-capacity circular experience replay buffer, stored as a structure of arrays. In prioritized mode experiences
+// are sampled proportionally to their last TD-error (through a sum-tree) instead of uniformly.
+class ReplayBuffer {
+public:
+    explicit ReplayBuffer(int capacity, bool prioritized = false);
+
+    // Store an experience, overwriting the oldest one once the buffer is full
+    void push(int x1, int y1, int action, double reward, int x2, int y2);
+
+    [[nodiscard]] int size() const;
+
+    // Sample a minibatch and apply all of its Q-updates to the node in one pass
+    void replay(const TreeNode *node, int batchSize, Rng &rng, QChangeTracker &tracker);
 
 private:
-    int x1, y1, action;
-    double reward;
-    int x2, y2;
+    int capacity, head, count;
+    bool prioritized;
+    vector<int> x1s, y1s, actions, x2s, y2s;
+    vector<double> rewards;
+    vector<int> batch; // Sampled indices, reused across minibatches
+    SumTree priorities;
+    double maxPriority;
 };
 
 class SingleAgentTraining {
 public:
-    SingleAgentTraining(TreeNode *node, const Maze &maze, int rows, int cols, int startRow,
-                        int startCol, int endRow, int endCol, int maxStepsPerEpisode);
+    SingleAgentTraining(TreeNode *node, const Maze &maze, int startRow, int startCol, int endRow, int endCol,
+                        int maxStepsPerEpisode, Rng &rng, bool prioritizedReplay = false);
 };
 
 
@@ -1,5 +1,10 @@
 #include "startstats.h"
 
+#include <algorithm>
+#include <bit>
+
+#include "maze.h"
+
 StartStats::StartStats() : attempts(0), successes(0) {
 }
 
@@ -14,3 +19,75 @@ void StartStats::incrementAttempts() {
 void StartStats::incrementSuccesses() {
     successes++;
 }
+
+StartStatsGrid::StartStatsGrid(const Maze &maze, const int startRow, const int startCol, const int endRow,
+                               const int endCol) : startRow(startRow), startCol(startCol),
+                                                   localCols(endCol - startCol + 1),
+                                                   cellCount((endRow - startRow + 1) * (endCol - startCol + 1)),
+                                                   recorded(0), stats(cellCount), weights(cellCount, 0.0),
+                                                   tree(cellCount + 1, 0.0), total(0.0) {
+    // Cells without statistics have a success rate of 0
+    for (int i = 0; i < cellCount; ++i) {
+        const int row = startRow + i / localCols;
+        const int col = startCol + i % localCols;
+        if (maze.cell(row, col) != constants::OBSTACLE) {
+            weights[i] = weightFor(stats[i]);
+            total += weights[i];
+        }
+    }
+
+    // Build the Fenwick tree in O(n)
+    for (int i = 1; i <= cellCount; ++i) {
+        tree[i] += weights[i - 1];
+        const int parent = i + (i & -i);
+        if (parent <= cellCount) tree[parent] += tree[i];
+    }
+}
+
+void StartStatsGrid::record(const int row, const int col, const bool success) {
+    const int index = (row - startRow) * localCols + (col - startCol);
+    stats[index].incrementAttempts();
+    if (success) stats[index].incrementSuccesses();
+    recorded++;
+
+    // Obstacles keep weight 0
+    if (weights[index] > 0.0) {
+        const double weight = weightFor(stats[index]);
+        add(index, weight - weights[index]);
+        weights[index] = weight;
+    }
+}
+
+bool StartStatsGrid::empty() const {
+    return recorded == 0;
+}
+
+pair<int, int> StartStatsGrid::sample(Rng &rng) const {
+    // Descend the Fenwick tree to the first cell whose prefix sum exceeds the drawn value
+    double value = rng.nextDouble() * total;
+    int position = 0;
+    for (int step = static_cast<int>(bit_floor(static_cast<unsigned>(cellCount))); step > 0; step >>= 1) {
+        if (position + step <= cellCount && tree[position + step] <= value) {
+            position += step;
+            value -= tree[position];
+        }
+    }
+
+    // Guard against rounding errors landing on the end or on an obstacle
+    int index = min(position, cellCount - 1);
+    while (index > 0 && weights[index] <= 0.0) index--;
+    while (index < cellCount - 1 && weights[index] <= 0.0) index++;
+    return {startRow + index / localCols, startCol + index % localCols};
+}
+
+double StartStatsGrid::weightFor(const StartStats &stats) {
+    constexpr double epsilon = 0.1; // Ensure non-zero probability
+    return 1.0 - stats.getSuccessRate() + epsilon;
+}
+
+void StartStatsGrid::add(const int index, const double delta) {
+    total += delta;
+    for (int i = index + 1; i <= cellCount; i += i & -i) {
+        tree[i] += delta;
+    }
+}
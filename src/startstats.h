@@ -1,6 +1,15 @@
 #ifndef STARTSTATS_H
 #define STARTSTATS_H
 
+#include <utility>
+#include <vector>
+
+#include "rng.h"
+
+using namespace std;
+
+class Maze;
+
 class StartStats {
 public:
     StartStats();
@@ -16,4 +25,33 @@ private:
     int successes;
 };
 
+// Start statistics of every cell of a subenvironment, stored densely, together with a Fenwick tree over the sampling
+// weights (lower success rate = higher weight, obstacles have weight 0). Recording a start and drawing a weighted start
+// position are both O(log n), no rebuild is needed per draw.
+class StartStatsGrid {
+public:
+    StartStatsGrid(const Maze &maze, int startRow, int startCol, int endRow, int endCol);
+
+    // Record an episode started at (row, col)
+    void record(int row, int col, bool success);
+
+    // True while no start has been recorded
+    [[nodiscard]] bool empty() const;
+
+    // Draw a non-obstacle position with probability proportional to its weight
+    [[nodiscard]] pair<int, int> sample(Rng &rng) const;
+
+private:
+    int startRow, startCol, localCols, cellCount;
+    int recorded;
+    vector<StartStats> stats;
+    vector<double> weights;
+    vector<double> tree; // Fenwick tree (1-based) over the weights
+    double total;
+
+    [[nodiscard]] static double weightFor(const StartStats &stats);
+
+    void add(int index, double delta);
+};
+
 #endif //STARTSTATS_H
@@ -0,0 +1,41 @@
+#include "sumtree.h"
+
+SumTree::SumTree(const int capacity) : leafCount(1) {
+    // Round the number of leaves up to a power of two so the tree is complete
+    while (leafCount < capacity) {
+        leafCount <<= 1;
+    }
+    tree.assign(2 * leafCount, 0.0);
+}
+
+void SumTree::update(const int index, const double priority) {
+    int node = index + leafCount;
+    tree[node] = priority;
+
+    // Recompute the sums on the path to the root (avoids accumulating rounding errors from incremental updates)
+    for (node >>= 1; node >= 1; node >>= 1) {
+        tree[node] = tree[2 * node] + tree[2 * node + 1];
+    }
+}
+
+double SumTree::getPriority(const int index) const {
+    return tree[index + leafCount];
+}
+
+double SumTree::getTotal() const {
+    return tree[1];
+}
+
+int SumTree::find(double value) const {
+    int node = 1;
+    while (node < leafCount) {
+        const int left = 2 * node;
+        if (value < tree[left] || tree[left + 1] <= 0.0) {
+            node = left;
+        } else {
+            value -= tree[left];
+            node = left + 1;
+        }
+    }
+    return node - leafCount;
+}
@@ -0,0 +1,28 @@
+#ifndef SUMTREE_H
+#define SUMTREE_H
+
+#include <vector>
+
+using namespace std;
+
+// Binary tree whose leaves hold priorities and whose inner nodes hold the sum of their children, used for
+// proportional sampling in prioritized experience replay. Updates and lookups are O(log n).
+class SumTree {
+public:
+    explicit SumTree(int capacity);
+
+    void update(int index, double priority);
+
+    [[nodiscard]] double getPriority(int index) const;
+
+    [[nodiscard]] double getTotal() const;
+
+    // Index of the leaf in which the prefix sum reaches value (0 <= value < total)
+    [[nodiscard]] int find(double value) const;
+
+private:
+    int leafCount;
+    vector<double> tree;
+};
+
+#endif //SUMTREE_H
@@ -1,27 +1,52 @@
 #include "table.h"
 
 template<typename T>
-Table<T>::Table(const int rows, const int cols, const int actions) : vector<vector<vector<T> > >(
-    rows, vector<vector<T> >(cols, vector<T>(actions, T(0)))) {
+Table<T>::Table(const int rows, const int cols, const int actions) : rows(rows), cols(cols), actions(actions),
+                                                                     values(static_cast<size_t>(rows) * cols * actions,
+                                                                            T(0)) {
 }
 
 template<typename T>
-Table<T>::Table(const Table<T> &other) : vector<vector<vector<T> > >(other) {
+Table<T>::Table(const Table<T> &other) : rows(other.rows), cols(other.cols), actions(other.actions),
+                                         values(other.values) {
 }
 
 template<typename T>
-vector<T> &Table<T>::operator()(const int globalRow, const int globalCol, const int startRow, const int startCol) {
-    return (*this)[globalRow - startRow][globalCol - startCol];
+span<T> Table<T>::operator()(const int globalRow, const int globalCol, const int startRow, const int startCol) {
+    const size_t offset = (static_cast<size_t>(globalRow - startRow) * cols + (globalCol - startCol)) * actions;
+    return {values.data() + offset, static_cast<size_t>(actions)};
+}
+
+template<typename T>
+span<const T> Table<T>::operator()(const int globalRow, const int globalCol, const int startRow,
+                                   const int startCol) const {
+    const size_t offset = (static_cast<size_t>(globalRow - startRow) * cols + (globalCol - startCol)) * actions;
+    return {values.data() + offset, static_cast<size_t>(actions)};
 }
 
 template<typename T>
 int Table<T>::getRows() const {
-    return this->size();
+    return rows;
 }
 
 template<typename T>
 int Table<T>::getCols() const {
-    return this->empty() ? 0 : (*this)[0].size();
+    return cols;
+}
+
+template<typename T>
+int Table<T>::getActions() const {
+    return actions;
+}
+
+template<typename T>
+T *Table<T>::data() {
+    return values.data();
+}
+
+template<typename T>
+const T *Table<T>::data() const {
+    return values.data();
 }
 
 // Explicit template instantiations for int and double
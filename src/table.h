@@ -1,22 +1,65 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include <cstddef>
+#include <new>
+#include <span>
 #include <vector>
 
 using namespace std;
 
+// Allocator handing out 64-byte (cache line) aligned storage, so every 8-action row of a Table<double> starts on its
+// own cache line
 template<typename T>
-class Table : vector<vector<vector<T> > > {
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr size_t alignment = 64;
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    explicit AlignedAllocator(const AlignedAllocator<U> &) {
+    }
+
+    T *allocate(const size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(alignment)));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, align_val_t(alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+};
+
+// Q-table stored in a single contiguous buffer (row-major, actions innermost)
+template<typename T>
+class Table {
 public:
     Table(int rows, int cols, int actions);
 
     Table(const Table<T> &other);
 
-    vector<T> &operator()(int globalRow, int globalCol, int startRow, int startCol);
+    Table<T> &operator=(const Table<T> &other) = default;
+
+    span<T> operator()(int globalRow, int globalCol, int startRow, int startCol);
+
+    span<const T> operator()(int globalRow, int globalCol, int startRow, int startCol) const;
 
     [[nodiscard]] int getRows() const;
 
     [[nodiscard]] int getCols() const;
+
+    [[nodiscard]] int getActions() const;
+
+    T *data();
+
+    [[nodiscard]] const T *data() const;
+
+private:
+    int rows, cols, actions;
+    vector<T, AlignedAllocator<T> > values;
 };
 
 #endif //TABLE_H
@@ -5,62 +5,28 @@ tuple<double, double, double> TestPolicy::testAgent(const TreeNode *root) {
     const Maze &maze = *root->maze;
     const int rows = root->rows;
     const int cols = root->cols;
-    const int maxStepsPerEpisode = rows + cols;
 
-    // Collect all valid positions to test
-    vector<pair<int, int> > positions;
-    int totalPositions = 0;
-    for (int x1 = 0; x1 < rows; ++x1) {
-        for (int y1 = 0; y1 < cols; ++y1) {
-            if (maze(x1, y1) != constants::OBSTACLE) {
-                positions.emplace_back(x1, y1);
-                totalPositions++;
-            }
-        }
-    }
-
-    // Function to process a chunk of positions and return results
-    auto processChunk = [&](const size_t startIdx, const size_t endIdx) -> ThreadResult {
-        ThreadResult result;
-        for (size_t i = startIdx; i < endIdx && i < positions.size(); ++i) {
-            const int x1 = positions[i].first;
-            const int y1 = positions[i].second;
-
-            auto start = chrono::high_resolution_clock::now();
-            auto [success, steps, path] = root->findValidPath(x1, y1, maxStepsPerEpisode);
-            auto end = chrono::high_resolution_clock::now();
+    // Steps to a charging station from every position (within rows + cols steps), kept up to date by the evaluator
+    auto start = chrono::high_resolution_clock::now();
+    root->evaluator->refresh(*root);
+    const vector<int> &distances = root->evaluator->getDistances();
 
-            result.planningTime += chrono::duration<double>(end - start).count();
-            if (success) {
-                result.successfulPaths++;
-                result.totalSteps += steps;
+    // Aggregate the results over all valid positions
+    const ThreadResult result = ThreadResult::collectRows(rows, [&](const int x1, ThreadResult &chunk) {
+        for (int y1 = 0; y1 < cols; ++y1) {
+            if (maze.cell(x1, y1) == constants::OBSTACLE) continue;
+            chunk.totalPositions++;
+            if (const int steps = distances[x1 * cols + y1]; steps >= 0) {
+                chunk.successfulPaths++;
+                chunk.totalSteps += steps;
             }
         }
-        return result;
-    };
-
-    // Split into chunks and process in parallel
-    const size_t totalTasks = positions.size();
-    constexpr size_t chunkSize = 100;
-    vector<future<ThreadResult> > futures;
-
-    // Determine the number of threads to use
-    for (size_t i = 0; i < totalTasks; i += chunkSize) {
-        size_t startIdx = i;
-        size_t endIdx = min(i + chunkSize, totalTasks);
-        futures.push_back(async(launch::async, processChunk, startIdx, endIdx));
-    }
-
-    // Aggregate results (single-threaded, after all threads finish)
-    double totalPlanningTime = 0.0;
-    int successfulPaths = 0;
-    int totalSteps = 0;
-    for (auto &f: futures) {
-        ThreadResult r = f.get();
-        totalPlanningTime += r.planningTime;
-        successfulPaths += r.successfulPaths;
-        totalSteps += r.totalSteps;
-    }
+    });
+    auto end = chrono::high_resolution_clock::now();
+    const double totalPlanningTime = chrono::duration<double>(end - start).count();
+    const int totalPositions = result.totalPositions;
+    const int successfulPaths = result.successfulPaths;
+    const int totalSteps = result.totalSteps;
 
     // Compute final metrics
     double successRate = totalPositions > 0 ? static_cast<double>(successfulPaths) / totalPositions : 0.0;
@@ -2,7 +2,6 @@
 #define TESTPOLICY_H
 
 #include <chrono>
-#include <future>
 
 #include "threadresult.h"
 #include "treenode.h"
@@ -0,0 +1,142 @@
+#include "threadpool.h"
+
+namespace {
+    // Pool and queue owned by the current thread (only set for pool workers)
+    thread_local const ThreadPool *currentPool = nullptr;
+    thread_local int currentQueueIndex = -1;
+
+    // Pool returned by getInstance() on the current thread, nullptr for the shared pool
+    thread_local ThreadPool *assignedPool = nullptr;
+}
+
+ThreadPool::ThreadPool(const unsigned threadCount) : stopping(false) {
+    for (unsigned i = 0; i <= threadCount; ++i) {
+        queues.push_back(make_unique<Queue>());
+    }
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workChanged.notify_all();
+    for (thread &worker: workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool &ThreadPool::getInstance() {
+    if (assignedPool) return *assignedPool;
+
+    // The thread calling parallelFor takes the place of one hardware thread
+    static ThreadPool pool(max(2u, thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::assignCurrentThread(ThreadPool *pool) {
+    assignedPool = pool;
+}
+
+void ThreadPool::parallelFor(const int count, const function<void(int)> &body) {
+    if (count <= 0) return;
+
+    const auto batch = make_shared<Batch>();
+    batch->body = &body;
+    batch->count = count;
+    batch->next = 0;
+    batch->done = 0;
+    {
+        Queue &queue = *queues[ownQueueIndex()];
+        lock_guard<mutex> lock(queue.queueMutex);
+        queue.batches.push_back(batch);
+    }
+    {
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    workChanged.notify_all();
+
+    // Help with queued work (own newest batch first, which is this one) until the batch is finished
+    while (batch->done.load() < count) {
+        if (!runOne()) {
+            unique_lock<mutex> lock(sleepMutex);
+            workChanged.wait(lock, [this, &batch, count] {
+                return batch->done.load() == count || hasWork();
+            });
+        }
+    }
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size());
+}
+
+int ThreadPool::ownQueueIndex() const {
+    return currentPool == this ? currentQueueIndex : static_cast<int>(queues.size()) - 1;
+}
+
+bool ThreadPool::claim(const int queueIndex, const bool newest, shared_ptr<Batch> &batch, int &index) {
+    Queue &queue = *queues[queueIndex];
+    lock_guard<mutex> lock(queue.queueMutex);
+    if (queue.batches.empty()) return false;
+
+    batch = newest ? queue.batches.back() : queue.batches.front();
+    index = batch->next++;
+
+    // Drop the batch from the queue once all of its indices are handed out
+    if (batch->next == batch->count) {
+        if (newest) queue.batches.pop_back();
+        else queue.batches.pop_front();
+    }
+    return true;
+}
+
+bool ThreadPool::runOne() {
+    shared_ptr<Batch> batch;
+    int index;
+
+    // Own queue first (newest batch), then steal the oldest batch of the other queues
+    const int own = ownQueueIndex();
+    const int queueCount = static_cast<int>(queues.size());
+    bool found = claim(own, true, batch, index);
+    for (int offset = 1; !found && offset < queueCount; ++offset) {
+        found = claim((own + offset) % queueCount, false, batch, index);
+    }
+    if (!found) return false;
+
+    (*batch->body)(index);
+
+    // Wake up the thread waiting for this batch once its last index is done
+    if (batch->done.fetch_add(1) + 1 == batch->count) {
+        lock_guard<mutex> lock(sleepMutex);
+        workChanged.notify_all();
+    }
+    return true;
+}
+
+bool ThreadPool::hasWork() {
+    for (const unique_ptr<Queue> &queue: queues) {
+        lock_guard<mutex> lock(queue->queueMutex);
+        if (!queue->batches.empty()) return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(const int queueIndex) {
+    currentPool = this;
+    currentQueueIndex = queueIndex;
+    assignedPool = this;
+    while (true) {
+        if (runOne()) continue;
+
+        unique_lock<mutex> lock(sleepMutex);
+        workChanged.wait(lock, [this] { return stopping || hasWork(); });
+        if (stopping && !hasWork()) return;
+    }
+}
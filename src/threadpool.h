@@ -0,0 +1,80 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Work-stealing pool of persistent worker threads, by default one pool shared by the whole program. Work is submitted
+// as batches of indices through parallelFor, which returns once every index has been processed. Every worker owns a
+// queue: it pushes the batches it submits to the back and works on its newest batch first, while idle workers steal the
+// oldest batch from another queue. Batches submitted by threads outside the pool go to a shared queue. The calling
+// thread helps with queued work while it waits, so parallelFor can safely be nested (e.g. federated agents inside a
+// node task).
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Pool of the calling thread: the pool it works for or was assigned to, otherwise the shared pool sized to the
+    // hardware (the thread calling parallelFor also works), created on first use
+    static ThreadPool &getInstance();
+
+    // Route getInstance() of the calling thread to the given pool, nullptr returns it to the shared pool. Gives a job
+    // a fixed set of threads, including the nested work its tasks submit.
+    static void assignCurrentThread(ThreadPool *pool);
+
+    // Run body(i) for every i in [0, count) on the pool and the calling thread, returns when all calls are finished.
+    // Indices are handed out in increasing order.
+    void parallelFor(int count, const function<void(int)> &body);
+
+    [[nodiscard]] int getThreadCount() const;
+
+private:
+    struct Batch {
+        const function<void(int)> *body;
+        int count;
+        int next; // Next index to hand out, guarded by the mutex of the queue holding the batch
+        atomic<int> done;
+    };
+
+    struct Queue {
+        mutex queueMutex;
+        deque<shared_ptr<Batch> > batches; // Only batches that still have indices to hand out
+    };
+
+    vector<thread> workers;
+    vector<unique_ptr<Queue> > queues; // One per worker, the last one is shared by threads outside the pool
+    mutex sleepMutex;
+    condition_variable workChanged;
+    bool stopping;
+
+    // Index of the queue owned by the calling thread
+    [[nodiscard]] int ownQueueIndex() const;
+
+    // Claim one index from a queue, from the newest batch (own queue) or the oldest batch (stealing)
+    bool claim(int queueIndex, bool newest, shared_ptr<Batch> &batch, int &index);
+
+    // Claim and run one index of the queued work, returns false if there was nothing to run
+    bool runOne();
+
+    // True if any queue holds work (requires sleepMutex)
+    [[nodiscard]] bool hasWork();
+
+    void workerLoop(int queueIndex);
+};
+
+#endif //THREADPOOL_H
@@ -1,10 +1,37 @@
 #ifndef THREADRESULT_H
 #define THREADRESULT_H
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "threadpool.h"
+
 struct ThreadResult {
-    double planningTime = 0.0;
+    int totalPositions = 0;
     int successfulPaths = 0;
     int totalSteps = 0;
+
+    // Evaluate the rows of a map in chunks handed out dynamically on the shared thread pool. Every chunk accumulates
+    // into its own result, the results are summed in row order afterwards.
+    static ThreadResult collectRows(const int rows, const function<void(int, ThreadResult &)> &evaluateRow) {
+        constexpr int chunkRows = 8;
+        const int chunkCount = (rows + chunkRows - 1) / chunkRows;
+        vector<ThreadResult> chunkResults(chunkCount);
+        ThreadPool::getInstance().parallelFor(chunkCount, [&](const int chunk) {
+            for (int row = chunk * chunkRows; row < min(rows, (chunk + 1) * chunkRows); ++row) {
+                evaluateRow(row, chunkResults[chunk]);
+            }
+        });
+
+        ThreadResult total;
+        for (const ThreadResult &result: chunkResults) {
+            total.totalPositions += result.totalPositions;
+            total.successfulPaths += result.successfulPaths;
+            total.totalSteps += result.totalSteps;
+        }
+        return total;
+    }
 };
 
 #endif //THREADRESULT_H
@@ -3,12 +3,14 @@
 TreeNode::TreeNode(const Maze &fullMaze, const int rows, const int cols, const int startRow, const int startCol,
                    const int endRow, const int endCol, TreeNode *parent, const bool isRoot) : parent(parent),
     rows(rows), cols(cols), startRow(startRow), startCol(startCol), endRow(endRow), endCol(endCol),
-    baselineSuccessRate(-1.0) {
+    baselineSuccessRate(-1.0), hasQTable(false) {
     if (isRoot) {
         maze = make_unique<Maze>(fullMaze);
+        evaluator = make_unique<PolicyEvaluator>();
         initQTable();
     }
     chargingStationCount = countChargingStations(fullMaze);
+    initActionMasks();
 }
 
 // Destructor
@@ -21,30 +23,96 @@ TreeNode::~TreeNode() {
 
 // Initialize 3D Q-table array
 void TreeNode::initQTable() {
-    if (!qTable) {
-        const int localRows = endRow - startRow + 1;
+    if (qTable) return;
+
+    const int localRows = endRow - startRow + 1;
+    const int localCols = endCol - startCol + 1;
+    qTable = make_unique<Table<double> >(localRows, localCols, constants::ACTION_COUNT);
+    if (!parent) {
+        hasQTable = true;
+        return;
+    }
+
+    // Start from the shared Q-values of the region once the node (or an ancestor) has been trained
+    if (hasQTable) {
+        const TreeNode *root = this;
+        while (root->parent) root = root->parent;
+        for (int row = startRow; row <= endRow; ++row) {
+            const span<const double> storeRow = (*root->qTable)(row, startCol, root->startRow, root->startCol);
+            ranges::copy_n(storeRow.begin(), localCols * constants::ACTION_COUNT,
+                           getQValues(row, startCol, startRow, startCol).begin());
+        }
+    }
+}
+
+void TreeNode::commitQTable() {
+    if (!qTable) return;
+
+    const TreeNode *root = this;
+    while (root->parent) root = root->parent;
+    root->evaluator->invalidate(startRow, startCol, endRow, endCol);
+
+    // The root trains on the shared table directly
+    if (parent) {
         const int localCols = endCol - startCol + 1;
-        qTable = make_unique<Table<double> >(localRows, localCols, constants::ACTION_COUNT);
+        for (int row = startRow; row <= endRow; ++row) {
+            const span<double> storeRow = (*root->qTable)(row, startCol, root->startRow, root->startCol);
+            ranges::copy_n(getQValues(row, startCol, startRow, startCol).begin(), localCols * constants::ACTION_COUNT,
+                           storeRow.begin());
+        }
+        qTable.reset();
+    }
+
+    // The node and all its descendants now read their Q-values from the trained region
+    stack<TreeNode *> toVisit;
+    toVisit.push(this);
+    while (!toVisit.empty()) {
+        TreeNode *current = toVisit.top();
+        toVisit.pop();
+        current->hasQTable = true;
+        for (TreeNode *child: current->children) {
+            toVisit.push(child);
+        }
     }
 }
 
-vector<double> &TreeNode::getQValues(const int globalRow, const int globalCol, const int startRow,
+// Precompute the valid-action bitmask of every cell in the subenvironment
+void TreeNode::initActionMasks() {
+    const int localRows = endRow - startRow + 1;
+    const int localCols = endCol - startCol + 1;
+    actionMasks.assign(static_cast<size_t>(localRows) * localCols, 0);
+    for (int x = startRow; x <= endRow; ++x) {
+        for (int y = startCol; y <= endCol; ++y) {
+            uint8_t mask = 0;
+            for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+                const int newX = x + constants::ROW_OFFSETS[i];
+                const int newY = y + constants::COL_OFFSETS[i];
+                if (newX >= startRow && newX <= endRow && newY >= startCol && newY <= endCol) {
+                    mask |= 1 << i;
+                }
+            }
+            actionMasks[(x - startRow) * localCols + (y - startCol)] = mask;
+        }
+    }
+}
+
+span<double> TreeNode::getQValues(const int globalRow, const int globalCol, const int startRow,
                                      const int startCol) const {
     // Return the reference to the Q-values for the specified position
     return (*qTable)(globalRow, globalCol, startRow, startCol);
 }
 
-void TreeNode::printTree(const string &prefix, const bool isLast, const bool isRoot) const {
+void TreeNode::printTree(ostream &out, const string &prefix, const bool isLast, const bool isRoot) const {
     // For the root node, don't add any symbols
     if (isRoot) {
-        cout << "Node: Start(" << startRow << ", " << startCol << "), "
+        out << "Node: Start(" << startRow << ", " << startCol << "), "
                 << "End(" << endRow << ", " << endCol << "), "
                 << "Size(" << (endRow - startRow + 1) << "x" << (endCol - startCol + 1)
                 << "), " << "Charging Stations: " << chargingStationCount << "\n";
     } else {
         // For all other nodes, add the appropriate symbols
         const string currentPrefix = prefix + (isLast ? "└─ " : "├─ ");
-        cout << currentPrefix
+        out << currentPrefix
                 << "Node: Start(" << startRow << ", " << startCol << "), "
                 << "End(" << endRow << ", " << endCol << "), "
                 << "Size(" << (endRow - startRow + 1) << "x" << (endCol - startCol + 1)
@@ -61,7 +129,7 @@ void TreeNode::printTree(const string &prefix, const bool isLast, const bool isR
 
     // Traverse children
     for (size_t i = 0; i < children.size(); ++i) {
-        children[i]->printTree(childPrefix, i == children.size() - 1, false);
+        children[i]->printTree(out, childPrefix, i == children.size() - 1, false);
     }
 }
 
@@ -82,6 +150,27 @@ void TreeNode::addChild(TreeNode *child) {
     children.push_back(child);
 }
 
+vector<pair<int, int> > TreeNode::applyMazeChanges(const span<const CellChange> changes) {
+    vector<pair<int, int> > changedCells;
+    for (const auto &[row, col, previous]: maze->applyChanges(changes)) {
+        changedCells.emplace_back(row, col);
+
+        // Keep the charging station counts of the leaf and its ancestors in step with the maze
+        const int delta = (maze->cell(row, col) == constants::CHARGING_STATION) -
+                          (previous == constants::CHARGING_STATION);
+        if (delta == 0) continue;
+        const span<TreeNode *const> chain = getAncestorChain(row, col);
+        if (chain.empty()) {
+            chargingStationCount += delta;
+        }
+        for (TreeNode *node: chain) {
+            node->chargingStationCount += delta;
+        }
+    }
+    evaluator->cellsChanged(changedCells);
+    return changedCells;
+}
+
 // Find leaf sub-environment for a given position
 TreeNode *TreeNode::findSubEnvironment(const int row, const int col) {
     if (row < startRow || row > endRow || col < startCol || col > endCol) {
@@ -90,6 +179,10 @@ TreeNode *TreeNode::findSubEnvironment(const int row, const int col) {
     if (children.empty()) {
         return this;
     }
+    if (!cellLeaves.empty()) {
+        const int leaf = cellLeaves[(row - startRow) * (endCol - startCol + 1) + (col - startCol)];
+        return leafChains[leafChainStarts[leaf]];
+    }
     for (TreeNode *child: children) {
         TreeNode *result = child->findSubEnvironment(row, col);
         if (result) return result;
@@ -97,215 +190,301 @@ TreeNode *TreeNode::findSubEnvironment(const int row, const int col) {
     return nullptr;
 }
 
-void TreeNode::updateQTable(const int x1, const int y1, const int action, const double reward, const int x2,
-                            const int y2) const {
+span<TreeNode *const> TreeNode::getAncestorChain(const int row, const int col) const {
+    if (row < startRow || row > endRow || col < startCol || col > endCol || cellLeaves.empty()) {
+        return {};
+    }
+    const int leaf = cellLeaves[(row - startRow) * (endCol - startCol + 1) + (col - startCol)];
+    return span(leafChains).subspan(leafChainStarts[leaf], leafChainStarts[leaf + 1] - leafChainStarts[leaf]);
+}
+
+double TreeNode::updateQTable(const int x1, const int y1, const int action, const double reward, const int x2,
+                              const int y2) const {
     // Ensure node and qTable exist
-    if (!qTable) return;
+    if (!qTable) return 0.0;
 
     // Access Q-values for current state (x1, y1)
-    vector<double> &qValues = getQValues(x1, y1, startRow, startCol);
+    const span<double> qValues = getQValues(x1, y1, startRow, startCol);
 
     // Access Q-values for next state (x2, y2)
-    const vector<double> &nextQValues = getQValues(x2, y2, startRow, startCol);
+    const span<const double> nextQValues = getQValues(x2, y2, startRow, startCol);
 
     // Get the maximum Q-value for the next state
     const double maxQNext = *ranges::max_element(nextQValues);
 
     // Update the Q-value for the current state and action
-    qValues[action] += constants::LEARNING_RATE * (reward + constants::DISCOUNT_FACTOR * maxQNext - qValues[action]);
+    const double tdError = reward + constants::DISCOUNT_FACTOR * maxQNext - qValues[action];
+    qValues[action] += constants::LEARNING_RATE * tdError;
+    return tdError;
 }
 
-int TreeNode::selectAction(const int x, const int y, const double epsilon) const {
-    const double randomValue = static_cast<double>(rand()) / RAND_MAX;
-
-    // Define possible moves
-    const vector<pair<int, int> > moves = {
-        {-1, 0}, // N
-        {-1, 1}, // NE
-        {0, 1}, // E
-        {1, 1}, // SE
-        {1, 0}, // S
-        {1, -1}, // SW
-        {0, -1}, // W
-        {-1, -1} // NW
-    };
+int TreeNode::selectAction(const int x, const int y, const double epsilon, Rng &rng) const {
+    const double randomValue = rng.nextDouble();
 
-    // Filter valid actions based on boundaries of the subenvironment
-    vector<int> validActions;
-    for (int i = 0; i < constants::ACTION_COUNT; ++i) {
-        const int newX = x + moves[i].first;
-        const int newY = y + moves[i].second;
-        if (newX >= startRow && newX <= endRow && newY >= startCol && newY <= endCol) {
-            validActions.push_back(i);
-        }
-    }
+    // Valid actions based on boundaries of the subenvironment
+    const unsigned mask = actionMasks[(x - startRow) * (endCol - startCol + 1) + (y - startCol)];
 
     // Epsilon-greedy action selection
-    int action;
     if (randomValue < epsilon) {
-        // Exploration: Choose a random valid action
-        action = validActions[rand() % validActions.size()];
-    } else {
-        // Exploitation: Choose the action with the highest Q-value among valid actions
-        const vector<double> &qValues = getQValues(x, y, startRow, startCol);
-        action = validActions[0];
-        double maxQValue = qValues[validActions[0]];
-        for (const int i: validActions) {
-            if (qValues[i] > maxQValue) {
-                maxQValue = qValues[i];
-                action = i;
-            }
+        // Exploration: Choose a random valid action (the n-th set bit of the mask)
+        unsigned remaining = mask;
+        for (int n = rng.nextInt(popcount(mask)); n > 0; --n) {
+            remaining &= remaining - 1;
         }
+        return countr_zero(remaining);
     }
-    return action;
-}
-
-vector<int> TreeNode::selectTopKActions(const vector<double> &qValues, const int rows, const int cols, const int x,
-                                        const int y, const int k) {
-    const vector<pair<int, int> > moves = {{-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}};
-    vector<pair<double, int> > validQValues;
 
-    // Collect valid actions based on rows and cols boundaries
+    // Exploitation: Choose the action with the highest Q-value among valid actions. Invalid actions are masked to
+    // -infinity and the maximum is found with a branch-free reduction tree, ties go to the lowest action index.
+    const span<const double> qValues = getQValues(x, y, startRow, startCol);
+    double masked[constants::ACTION_COUNT];
     for (int i = 0; i < constants::ACTION_COUNT; ++i) {
-        const int newX = x + moves[i].first;
-        const int newY = y + moves[i].second;
-        if (newX >= 0 && newX < rows && newY >= 0 && newY < cols) {
-            validQValues.emplace_back(qValues[i], i);
-        }
+        masked[i] = mask >> i & 1u ? qValues[i] : -numeric_limits<double>::infinity();
+    }
+    const double max01 = max(masked[0], masked[1]), max23 = max(masked[2], masked[3]);
+    const double max45 = max(masked[4], masked[5]), max67 = max(masked[6], masked[7]);
+    const double maxQValue = max(max(max01, max23), max(max45, max67));
+    unsigned best = 0;
+    for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+        best |= static_cast<unsigned>(masked[i] == maxQValue) << i;
     }
+    return countr_zero(best & mask);
+}
 
-    if (validQValues.empty()) {
-        cerr << "Error: No valid actions at (" << x << ", " << y << ")\n";
-        return {};
+pair<int, int> TreeNode::selectTopTwoActions(const int x, const int y) const {
+    const span<const double> qValues = getQValues(x, y, startRow, startCol);
+    const unsigned mask = actionMasks[(x - startRow) * (endCol - startCol + 1) + (y - startCol)];
+    int first = -1, second = -1;
+    for (int i = 0; i < constants::ACTION_COUNT; ++i) {
+        if (!(mask >> i & 1u)) continue;
+        if (first < 0 || qValues[i] >= qValues[first]) {
+            second = first;
+            first = i;
+        } else if (second < 0 || qValues[i] >= qValues[second]) {
+            second = i;
+        }
     }
+    return {first, second};
+}
 
-    // Sort by Q-value descending
-    ranges::sort(validQValues, greater<pair<double, int> >());
+namespace {
+    // Reusable per-thread buffers of findValidPath: one entry per discovered cell (with the entry it was reached from)
+    // and a visited stamp per maze cell. A new search only bumps the generation instead of clearing the stamps.
+    struct PathSearchBuffers {
+        struct Entry {
+            int x, y, steps, parent;
+        };
+
+        vector<Entry> entries;
+        vector<uint32_t> visited;
+        uint32_t generation = 0;
+
+        void prepare(const Maze &maze) {
+            const size_t cellCount = static_cast<size_t>(maze.getRows() + 2) * maze.getStride();
+            if (visited.size() < cellCount) {
+                visited.assign(cellCount, 0);
+                generation = 0;
+            }
+            if (entries.capacity() < cellCount) {
+                entries.reserve(cellCount);
+            }
+            entries.clear();
+            if (++generation == 0) {
+                // Stamps wrapped around, start over
+                ranges::fill(visited, 0);
+                generation = 1;
+            }
+        }
+    };
 
-    // Return top k actions (or all if fewer than k)
-    vector<int> actions;
-    for (int i = 0; i < min(k, static_cast<int>(validQValues.size())); ++i) {
-        actions.push_back(validQValues[i].second);
-    }
-    return actions;
+    thread_local PathSearchBuffers pathSearchBuffers;
 }
 
-tuple<bool, int, vector<pair<int, int> > > TreeNode::findValidPath(const int startX, const int startY,
-                                                                   const int maxSteps) const {
-    // Define possible moves
-    const vector<pair<int, int> > moves = {{-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}};
-    queue<PathState> toExplore;
-    set<pair<int, int> > visited;
-    toExplore.push({startX, startY, 0, {{startX, startY}}});
-    visited.insert({startX, startY});
+pair<bool, int> TreeNode::findValidPath(const int startX, const int startY, const int maxSteps,
+                                        vector<pair<int, int> > *path) const {
+    PathSearchBuffers &buffers = pathSearchBuffers;
+    buffers.prepare(*maze);
+    vector<PathSearchBuffers::Entry> &entries = buffers.entries;
+    entries.push_back({startX, startY, 0, -1});
+    buffers.visited[maze->index(startX, startY)] = buffers.generation;
 
-    // Loop to find valid path
-    while (!toExplore.empty()) {
-        auto [x, y, steps, path] = toExplore.front();
-        toExplore.pop();
+    // Breadth-first search, the entries double as the queue
+    for (size_t next = 0; next < entries.size(); ++next) {
+        const auto [x, y, steps, parent] = entries[next];
 
         // Check if we reached the maximum steps
         if (steps >= maxSteps) continue;
 
         // Check if we reached the charging station
-        if ((*maze)(x, y) == constants::CHARGING_STATION) {
-            return {true, steps, path};
+        if (maze->cell(x, y) == constants::CHARGING_STATION) {
+            if (path) {
+                path->clear();
+                for (int i = static_cast<int>(next); i >= 0; i = entries[i].parent) {
+                    path->emplace_back(entries[i].x, entries[i].y);
+                }
+                ranges::reverse(*path);
+            }
+            return {true, steps};
         }
 
-        // Select top k actions based on Q-values
-        const vector<double> &qValues = getQValues(x, y, startRow, startCol);
-        vector<int> actions = selectTopKActions(qValues, rows, cols, x, y, 2);
-        for (const int act: actions) {
-            const int newX = x + moves[act].first;
-            const int newY = y + moves[act].second;
-            if ((*maze)(newX, newY) != constants::OBSTACLE && !visited.contains({newX, newY})) {
-                visited.insert({newX, newY});
-                vector<pair<int, int> > newPath = path;
-                newPath.emplace_back(newX, newY);
-                toExplore.push({newX, newY, steps + 1, newPath});
+        // Follow the top 2 actions based on Q-values
+        const auto [first, second] = selectTopTwoActions(x, y);
+        for (const int act: {first, second}) {
+            if (act < 0) continue;
+            const int newX = x + constants::ROW_OFFSETS[act];
+            const int newY = y + constants::COL_OFFSETS[act];
+            const int idx = maze->index(newX, newY);
+            if (maze->cellAt(idx) != constants::OBSTACLE && buffers.visited[idx] != buffers.generation) {
+                buffers.visited[idx] = buffers.generation;
+                entries.push_back({newX, newY, steps + 1, static_cast<int>(next)});
             }
         }
     }
-    return {false, 0, {}}; // No valid path
+    return {false, 0}; // No valid path
 }
 
-void TreeNode::createSubEnvironments(const Maze &maze) {
-    if ((endRow - startRow + 1) <= 20 && (endCol - startCol + 1) <= 20) {
-        return;
-    }
+namespace {
+    // Summed-area tables of the free cells and charging stations of the maze, for O(1) counts over any rectangle
+    class CellCounts {
+    public:
+        explicit CellCounts(const Maze &maze) : cols(maze.getCols()),
+                                                freeCells(static_cast<size_t>(maze.getRows() + 1) * (cols + 1), 0),
+                                                stations(freeCells.size(), 0) {
+            for (int row = 0; row < maze.getRows(); ++row) {
+                for (int col = 0; col < cols; ++col) {
+                    const int cell = maze.cell(row, col);
+                    const size_t i = index(row + 1, col + 1);
+                    freeCells[i] = (cell != constants::OBSTACLE) + freeCells[index(row, col + 1)] +
+                                   freeCells[index(row + 1, col)] - freeCells[index(row, col)];
+                    stations[i] = (cell == constants::CHARGING_STATION) + stations[index(row, col + 1)] +
+                                  stations[index(row + 1, col)] - stations[index(row, col)];
+                }
+            }
+        }
 
-    // Split the maze into four quadrants
-    const int midRow = (startRow + endRow) / 2;
-    const int midCol = (startCol + endCol) / 2;
-
-    // Create child nodes for each quadrant
-    auto *child1 = new TreeNode(maze, rows, cols, startRow, startCol, midRow, midCol, this);
-    auto *child2 = new TreeNode(maze, rows, cols, startRow, midCol + 1, midRow, endCol, this);
-    auto *child3 = new TreeNode(maze, rows, cols, midRow + 1, startCol, endRow, midCol, this);
-    auto *child4 = new TreeNode(maze, rows, cols, midRow + 1, midCol + 1, endRow, endCol, this);
-
-    // Add children to the current node
-    addChild(child1);
-    addChild(child2);
-    addChild(child3);
-    addChild(child4);
-
-    // Recursively split each child node
-    child1->createSubEnvironments(maze);
-    child2->createSubEnvironments(maze);
-    child3->createSubEnvironments(maze);
-    child4->createSubEnvironments(maze);
-}
+        [[nodiscard]] int countFree(const int startRow, const int startCol, const int endRow, const int endCol) const {
+            return sum(freeCells, startRow, startCol, endRow, endCol);
+        }
 
-void TreeNode::propagateQTableDownwards() {
-    if (!qTable) return; // Skip if no qTable
+        [[nodiscard]] int countStations(const int startRow, const int startCol, const int endRow,
+                                        const int endCol) const {
+            return sum(stations, startRow, startCol, endRow, endCol);
+        }
 
-    // Propagate to all descendants, updating only those with qTables
-    stack<TreeNode *> toVisit;
-    toVisit.push(this);
+    private:
+        int cols;
+        vector<int> freeCells, stations;
 
-    // DFS to propagate Q-tables
-    while (!toVisit.empty()) {
-        const TreeNode *current = toVisit.top();
-        toVisit.pop();
+        [[nodiscard]] size_t index(const int row, const int col) const {
+            return static_cast<size_t>(row) * (cols + 1) + col;
+        }
 
-        for (TreeNode *child: current->children) {
-            // If child has no qTable, initialize it
-            if (!child->qTable) {
-                child->initQTable();
+        [[nodiscard]] int sum(const vector<int> &table, const int startRow, const int startCol, const int endRow,
+                              const int endCol) const {
+            return table[index(endRow + 1, endCol + 1)] - table[index(startRow, endCol + 1)] -
+                   table[index(endRow + 1, startCol)] + table[index(startRow, startCol)];
+        }
+    };
+
+    struct Region {
+        int startRow, startCol, endRow, endCol;
+    };
+
+    // Cut a region in two along its longer side. The cut balances the free cells of both parts, preferring cuts that
+    // leave a charging station on each side (a part without stations has no reachable goal). Parts are kept at least a
+    // quarter of the side long, so leaves do not degenerate into thin strips.
+    pair<Region, Region> splitRegion(const Region &region, const CellCounts &counts) {
+        const bool splitRows = region.endRow - region.startRow >= region.endCol - region.startCol;
+        const int first = splitRows ? region.startRow : region.startCol;
+        const int last = splitRows ? region.endRow : region.endCol;
+        const int minLength = max(1, (last - first + 1) / 4);
+
+        auto parts = [&region, splitRows](const int cut) {
+            if (splitRows) {
+                return pair{Region{region.startRow, region.startCol, cut, region.endCol},
+                            Region{cut + 1, region.startCol, region.endRow, region.endCol}};
             }
-            // Copy Q-values for positions within child's subenvironment
-            for (int row = child->startRow; row <= child->endRow; ++row) {
-                for (int col = child->startCol; col <= child->endCol; ++col) {
-                    vector<double> &childQValues = child->getQValues(row, col, child->startRow, child->startCol);
-                    const vector<double> currentQValues = getQValues(row, col, startRow, startCol);
-                    childQValues = currentQValues; // Copy all action Q-values
-                }
+            return pair{Region{region.startRow, region.startCol, region.endRow, cut},
+                        Region{region.startRow, cut + 1, region.endRow, region.endCol}};
+        };
+
+        const int totalStations = counts.countStations(region.startRow, region.startCol, region.endRow, region.endCol);
+        int bestCut = (first + last) / 2;
+        double bestScore = numeric_limits<double>::infinity();
+        for (int cut = first + minLength - 1; cut <= last - minLength; ++cut) {
+            const auto [a, b] = parts(cut);
+            const int freeA = counts.countFree(a.startRow, a.startCol, a.endRow, a.endCol);
+            const int freeB = counts.countFree(b.startRow, b.startCol, b.endRow, b.endCol);
+            double score = static_cast<double>(abs(freeA - freeB)) / max(1, freeA + freeB);
+            if (totalStations > 1 && (counts.countStations(a.startRow, a.startCol, a.endRow, a.endCol) == 0 ||
+                                      counts.countStations(b.startRow, b.startCol, b.endRow, b.endCol) == 0)) {
+                score += 1.0; // Station coverage outweighs any imbalance
+            }
+            if (score < bestScore) {
+                bestScore = score;
+                bestCut = cut;
             }
-            toVisit.push(child); // Continue to child regardless of qTable
         }
+        return parts(bestCut);
     }
-}
 
-void TreeNode::propagateQTableUpwards() const {
-    if (!qTable || !parent) return; // Skip if no qTable or no parent
-
-    const TreeNode *current = parent; // Start at parent
-    while (current) {
-        // Continue until root (no parent)
-        if (current->qTable) {
-            // Update only if qTable exists
-            // Copy Q-values for positions within node's subenvironment
-            for (int row = startRow; row <= endRow; ++row) {
-                for (int col = startCol; col <= endCol; ++col) {
-                    vector<double> &parentQValues = current->getQValues(row, col, current->startRow, current->startCol);
-                    const vector<double> nodeQValues = getQValues(row, col, startRow, startCol);
-                    parentQValues = nodeQValues; // Copy all action Q-values
-                }
+    void splitNode(TreeNode *node, const Maze &maze, const CellCounts &counts, const int leafBudget) {
+        const Region region{node->startRow, node->startCol, node->endRow, node->endCol};
+        if (region.endRow == region.startRow && region.endCol == region.startCol) return;
+        if (counts.countFree(region.startRow, region.startCol, region.endRow, region.endCol) <= leafBudget) return;
+
+        // Two kd cuts: halve the region, then halve each half along its own longer side
+        const auto [firstHalf, secondHalf] = splitRegion(region, counts);
+        for (const Region &half: {firstHalf, secondHalf}) {
+            vector<Region> parts{half};
+            if (half.endRow > half.startRow || half.endCol > half.startCol) {
+                const auto [a, b] = splitRegion(half, counts);
+                parts = {a, b};
+            }
+            for (const Region &part: parts) {
+                auto *child = new TreeNode(maze, node->rows, node->cols, part.startRow, part.startCol, part.endRow,
+                                           part.endCol, node);
+                node->addChild(child);
             }
         }
-        current = current->parent; // Move up, even if no qTable
+
+        // Recursively split each child node
+        for (TreeNode *child: node->children) {
+            splitNode(child, maze, counts, leafBudget);
+        }
+    }
+}
+
+void TreeNode::createSubEnvironments(const Maze &maze, const int leafBudget) {
+    const CellCounts counts(maze);
+    splitNode(this, maze, counts, leafBudget);
+    buildLeafIndex();
+}
+
+void TreeNode::buildLeafIndex() {
+    const int localCols = endCol - startCol + 1;
+    cellLeaves.assign(static_cast<size_t>(endRow - startRow + 1) * localCols, 0);
+    leafChains.clear();
+    leafChainStarts.clear();
+
+    vector<TreeNode *> leafNodes;
+    collectLeafNodes(leafNodes);
+    for (int leaf = 0; leaf < static_cast<int>(leafNodes.size()); ++leaf) {
+        TreeNode *node = leafNodes[leaf];
+
+        // Chain from the leaf up to this node
+        leafChainStarts.push_back(static_cast<int>(leafChains.size()));
+        for (TreeNode *current = node; current; current = current->parent) {
+            leafChains.push_back(current);
+            if (current == this) break;
+        }
+
+        for (int row = node->startRow; row <= node->endRow; ++row) {
+            fill_n(cellLeaves.begin() + (row - startRow) * localCols + (node->startCol - startCol),
+                   node->endCol - node->startCol + 1, leaf);
+        }
     }
+    leafChainStarts.push_back(static_cast<int>(leafChains.size()));
 }
 
 void TreeNode::collectLeafNodes(vector<TreeNode *> &leafNodes) {
@@ -323,29 +502,7 @@ double TreeNode::computeSuccessRate(const TreeNode *root) const {
     if (!root || !root->maze || !root->qTable)
         return 0.0; // Safety checks
 
-    // Use the full maze from the root for pathfinding
-    const Maze &maze = *root->maze;
-    const int rows = root->rows;
-    const int cols = root->cols;
-    const int maxSteps = rows + cols; // Consistent with testAgent
-
-    int totalPositions = 0;
-    int successfulPaths = 0;
-
-    // Iterate over all positions within the node's subenvironment
-    for (int x = startRow; x <= endRow; ++x) {
-        for (int y = startCol; y <= endCol; ++y) {
-            if (maze(x, y) == constants::OBSTACLE) continue; // Skip obstacles
-            totalPositions++;
-
-            // Try to find a valid path from this position
-            auto [success, steps, path] = root->findValidPath(x, y, maxSteps);
-            if (success) {
-                successfulPaths++;
-            }
-        }
-    }
-
-    // Compute success rate
-    return totalPositions > 0 ? static_cast<double>(successfulPaths) / totalPositions : 0.0;
+    // Search again from the positions whose paths may run through changed Q-values or obstacles
+    root->evaluator->refresh(*root);
+    return root->evaluator->getSuccessRate(startRow, startCol, endRow, endCol);
 }
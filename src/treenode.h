@@ -2,16 +2,17 @@
 #define TREENODE_H
 
 #include <algorithm>
+#include <bit>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
-#include <set>
 #include <vector>
 #include <stack>
-#include <queue>
 
 #include "constants.h"
 #include "maze.h"
-#include "pathstate.h"
+#include "policyevaluator.h"
 #include "table.h"
 
 using namespace std;
@@ -19,13 +20,19 @@ using namespace std;
 class TreeNode {
 public:
     unique_ptr<Maze> maze; // Optional maze, only at root
-    unique_ptr<Table<double> > qTable; // 3D array Q-table
+    unique_ptr<PolicyEvaluator> evaluator; // Success bookkeeping of the greedy policy, only at root
+    unique_ptr<Table<double> > qTable; // 3D array Q-table, the shared store at the root, a working copy while training
     TreeNode *parent;
     vector<TreeNode *> children;
     int rows, cols;
     int startRow, startCol, endRow, endCol;
     int chargingStationCount;
     double baselineSuccessRate;
+    bool hasQTable; // Whether the node or one of its ancestors has been trained, i.e. its region holds its Q-values
+    vector<uint8_t> actionMasks; // Per cell bitmask of the actions that stay within the subenvironment
+    vector<int> cellLeaves; // Per cell, the leaf of the subtree containing it (built by createSubEnvironments)
+    vector<TreeNode *> leafChains; // Per leaf, the leaf followed by its ancestors up to this node
+    vector<int> leafChainStarts; // Per leaf, the start of its chain in leafChains (plus one end marker)
 
     // Constructor
     TreeNode(const Maze &fullMaze, int rows, int cols, int startRow, int startCol, int endRow, int endCol,
@@ -34,37 +41,59 @@ public:
     // Destructor
     ~TreeNode();
 
-    // Initialize 3D Q-table array
+    // Initialize 3D Q-table array. Other nodes than the root train on a private copy of their region of the root's
+    // table, or on zeros when the node was never trained before
     void initQTable();
 
-    [[nodiscard]] vector<double> &getQValues(int globalRow, int globalCol, int startRow, int startCol) const;
+    // Write the working copy back into the root's table and release it, the region is shared with all other nodes
+    void commitQTable();
+
+    // Precompute the valid-action bitmask of every cell in the subenvironment
+    void initActionMasks();
+
+    [[nodiscard]] span<double> getQValues(int globalRow, int globalCol, int startRow, int startCol) const;
 
     // Print tree structure
-    void printTree(const string &prefix = "", bool isLast = true, bool isRoot = true) const;
+    void printTree(ostream &out = cout, const string &prefix = "", bool isLast = true, bool isRoot = true) const;
 
     [[nodiscard]] int countChargingStations(const Maze &fullMaze) const;
 
     void addChild(TreeNode *child);
 
-    // Find leaf sub-environment for a given position
+    // Apply a batch of cell updates to the maze in place and notify the structures depending on it: the charging
+    // station counts along the leaf chains and the policy evaluator. Returns the cells whose type changed. Called on
+    // the root.
+    vector<pair<int, int> > applyMazeChanges(span<const CellChange> changes);
+
+    // Find leaf sub-environment for a given position, O(1) once createSubEnvironments built the cell index
     TreeNode *findSubEnvironment(int row, int col);
 
-    void updateQTable(int x1, int y1, int action, double reward, int x2, int y2) const;
+    // Leaf containing the given position followed by its ancestors up to this node, empty if outside or not indexed
+    [[nodiscard]] span<TreeNode *const> getAncestorChain(int row, int col) const;
 
-    [[nodiscard]] int selectAction(int x, int y, double epsilon) const;
+    // Returns the temporal-difference error of the update
+    double updateQTable(int x1, int y1, int action, double reward, int x2, int y2) const;
 
-    static vector<int> selectTopKActions(const vector<double> &qValues, int rows, int cols, int x, int y, int k);
+    [[nodiscard]] int selectAction(int x, int y, double epsilon, Rng &rng) const;
 
-    [[nodiscard]] tuple<bool, int, vector<pair<int, int> > > findValidPath(int startX, int startY, int maxSteps) const;
+    // Top 2 valid actions by Q-value (-1 if missing), ties go to the higher action index
+    [[nodiscard]] pair<int, int> selectTopTwoActions(int x, int y) const;
 
-    void createSubEnvironments(const Maze &maze);
+    // Breadth-first search along the top 2 greedy actions until a charging station is reached within maxSteps. Returns
+    // success and the number of steps, the path is only built when requested. Called on the root.
+    [[nodiscard]] pair<bool, int> findValidPath(int startX, int startY, int maxSteps,
+                                                vector<pair<int, int> > *path = nullptr) const;
 
-    void propagateQTableDownwards();
+    // Split into four children with two cost-balanced cuts per level, until every leaf is within the free-cell budget
+    void createSubEnvironments(const Maze &maze, int leafBudget = constants::LEAF_FREE_CELL_BUDGET);
 
-    void propagateQTableUpwards() const;
+    // Build the cell to leaf index and the leaf ancestor chains of the subtree
+    void buildLeafIndex();
 
     void collectLeafNodes(vector<TreeNode *> &leafNodes);
 
+    // Success rate of the greedy policy over the free cells of the subenvironment, only the cells affected by changes
+    // since the previous evaluation are searched again
     double computeSuccessRate(const TreeNode *root) const;
 };
 
@@ -1,70 +1,77 @@
 #include "treestrategy.h"
 
-void TreeStrategy::trainTreeNodesInParallel(const TreeNode *root, const vector<TreeNode *> &nodes,
-                                            const string &trainingMode) {
-    vector<thread> threads;
-    for (TreeNode *node: nodes) {
-        threads.emplace_back([root, node, trainingMode]() {
-            if (trainingMode == "singleAgent") {
-                const int maxSteps = (node->endRow - node->startRow + 1) + (node->endCol - node->startCol + 1);
-                SingleAgentTraining(node, *root->maze, node->rows, node->cols, node->startRow, node->startCol,
-                                    node->endRow, node->endCol, maxSteps);
-            } else if (trainingMode == "fedAsynQ_EqAvg") {
-                const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
-                MultiAgent::fedAsynQ_EqAvg(node, *root->maze, 1000, T, 12);
-            } else if (trainingMode == "fedAsynQ_ImAvg") {
-                const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
-                MultiAgent::fedAsynQ_ImAvg(node, *root->maze, 1000, T, 12);
-            }
-
-            // Propagate the Q-table results upwards
-            node->propagateQTableUpwards();
-            node->propagateQTableDownwards();
-        });
+void TreeStrategy::trainTreeNode(const TreeNode *root, TreeNode *node, const string &trainingMode, Rng &rng) {
+    if (trainingMode == "singleAgent") {
+        const int maxSteps = (node->endRow - node->startRow + 1) + (node->endCol - node->startCol + 1);
+        SingleAgentTraining(node, *root->maze, node->startRow, node->startCol, node->endRow, node->endCol, maxSteps,
+                            rng);
+    } else if (trainingMode == "singleAgentPrioritized") {
+        const int maxSteps = (node->endRow - node->startRow + 1) + (node->endCol - node->startCol + 1);
+        SingleAgentTraining(node, *root->maze, node->startRow, node->startCol, node->endRow, node->endCol, maxSteps,
+                            rng, true);
+    } else if (trainingMode == "fedAsynQ_EqAvg") {
+        const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
+        MultiAgent::fedAsynQ_EqAvg(node, *root->maze, 1000, T, 12, rng);
+    } else if (trainingMode == "fedAsynQ_ImAvg") {
+        const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
+        MultiAgent::fedAsynQ_ImAvg(node, *root->maze, 1000, T, 12, rng);
     }
-    for (thread &t: threads) {
-        if (t.joinable()) {
-            t.join();
-        }
+
+    // Share the results with the ancestors and descendants, which all view the root's Q-table
+    node->commitQTable();
+}
+
+void TreeStrategy::trainTreeNodesInParallel(const TreeNode *root, const vector<TreeNode *> &nodes,
+                                            const string &trainingMode, Rng &rng) {
+    // Derive one random number stream per node up front, so results do not depend on thread scheduling
+    vector<Rng> nodeRngs;
+    nodeRngs.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodeRngs.push_back(rng.split());
     }
+
+    // Training cost grows with the node area, so hand out the largest nodes first to keep the tail short
+    vector<int> order(nodes.size());
+    iota(order.begin(), order.end(), 0);
+    ranges::stable_sort(order, greater<>(), [&nodes](const int i) {
+        return (nodes[i]->endRow - nodes[i]->startRow + 1) * (nodes[i]->endCol - nodes[i]->startCol + 1);
+    });
+
+    // Every node is a task on the shared pool, federated agents inside a node run as nested tasks on the same pool
+    ThreadPool::getInstance().parallelFor(static_cast<int>(order.size()), [&](const int i) {
+        trainTreeNode(root, nodes[order[i]], trainingMode, nodeRngs[order[i]]);
+    });
 }
 
 void TreeStrategy::trainTreeNodesSequentially(const TreeNode *root, const vector<TreeNode *> &nodes,
-                                              const string &trainingMode) {
+                                              const string &trainingMode, Rng &rng) {
     for (TreeNode *node: nodes) {
-        if (trainingMode == "singleAgent") {
-            const int maxSteps = (node->endRow - node->startRow + 1) + (node->endCol - node->startCol + 1);
-            SingleAgentTraining(node, *root->maze, node->rows, node->cols, node->startRow, node->startCol, node->endRow,
-                                node->endCol, maxSteps);
-        } else if (trainingMode == "fedAsynQ_EqAvg") {
-            const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
-            MultiAgent::fedAsynQ_EqAvg(node, *root->maze, 1000, T, 12);
-        } else if (trainingMode == "fedAsynQ_ImAvg") {
-            const int T = (node->endRow - node->startRow + 1) * (node->endCol - node->startCol + 1) * 200;
-            MultiAgent::fedAsynQ_ImAvg(node, *root->maze, 1000, T, 12);
-        }
-
-        // Propagate the Q-table results upwards
-        node->propagateQTableUpwards();
-        node->propagateQTableDownwards();
+        // Same per-node stream derivation as the parallel variant
+        Rng nodeRng = rng.split();
+        trainTreeNode(root, node, trainingMode, nodeRng);
     }
 }
 
 void TreeStrategy::trainTreeNodes(const TreeNode *root, const vector<TreeNode *> &nodes, const bool &parallel,
-                                  const string &trainingMode) {
+                                  const string &trainingMode, Rng &rng) {
+    // Batches are often collected in hash sets keyed by node address. Handing out the random number streams in the
+    // order of the node positions keeps the results independent of where the nodes were allocated.
+    vector<TreeNode *> batch = nodes;
+    ranges::sort(batch, less<>(), [](const TreeNode *node) { return pair(node->startRow, node->startCol); });
+
     if (parallel) {
         // Train the nodes in parallel
-        trainTreeNodesInParallel(root, nodes, trainingMode);
+        trainTreeNodesInParallel(root, batch, trainingMode, rng);
     } else {
         // Train the nodes sequentially
-        trainTreeNodesSequentially(root, nodes, trainingMode);
+        trainTreeNodesSequentially(root, batch, trainingMode, rng);
     }
 
     cout << "Updating success rates...\n";
 
     // Recompute success rates for retrained nodes and their descendants
     unordered_set<TreeNode *> visited; // Track nodes to avoid recomputing shared descendants
-    for (TreeNode *node: nodes) {
+    for (TreeNode *node: batch) {
         if (visited.contains(node)) continue; // Skip if already processed
 
         // DFS to recompute success rates for node and descendants
@@ -80,7 +87,7 @@ void TreeStrategy::trainTreeNodes(const TreeNode *root, const vector<TreeNode *>
             visited.insert(current);
 
             // Recompute success rate if node has a qTable or was trained
-            if (current->qTable) {
+            if (current->hasQTable) {
                 const double newSuccessRate = current->computeSuccessRate(root);
                 current->baselineSuccessRate = newSuccessRate;
                 cout << "Node (" << current->startRow << ", " << current->startCol << ") -> (" << current->endRow <<
@@ -99,17 +106,17 @@ void TreeStrategy::trainTreeNodes(const TreeNode *root, const vector<TreeNode *>
 }
 
 
-void TreeStrategy::onlyTrainLeafNodes(TreeNode *root, const vector<TreeNode *> &changedLeaves) {
+void TreeStrategy::onlyTrainLeafNodes(TreeNode *root, Rng &rng, const vector<TreeNode *> &changedLeaves) {
     // Environment is static. Performing global path planning selectively
     if (changedLeaves.empty()) {
         // Train all leaf nodes initially
         vector<TreeNode *> leafNodes;
         root->collectLeafNodes(leafNodes);
-        trainTreeNodes(root, leafNodes, true, "singleAgent");
+        trainTreeNodes(root, leafNodes, true, "singleAgent", rng);
     }
     // Environment changed. Training affected leaf nodes
     else {
-        trainTreeNodes(root, changedLeaves, true, "singleAgent");
+        trainTreeNodes(root, changedLeaves, true, "singleAgent", rng);
     }
 }
 
@@ -117,7 +124,8 @@ double TreeStrategy::getRetrainingThreshold(const int mazeSize) {
     return 0.01;
 }
 
-void TreeStrategy::smartHierarchy(TreeNode *root, const vector<TreeNode *> &changedLeaves, const string &trainingMode) {
+void TreeStrategy::smartHierarchy(TreeNode *root, Rng &rng, const vector<TreeNode *> &changedLeaves,
+                                  const string &trainingMode) {
     if (!root) return; // Safety check: Exit if root is null
 
     cout << "\nBegin training...\n";
@@ -167,7 +175,7 @@ void TreeStrategy::smartHierarchy(TreeNode *root, const vector<TreeNode *> &chan
     if (!leavesToRetrain.empty()) {
         // Train all leaves marked for retraining in one batch
         cout << "Training leaves...\n";
-        trainTreeNodes(root, leavesToRetrain, true, trainingMode);
+        trainTreeNodes(root, leavesToRetrain, true, trainingMode, rng);
         cout << "Leaves trained.\n";
         for (const TreeNode *leaf: leavesToRetrain) {
             // const double newSuccessRate = computeNodeSuccessRate(root, leaf);
@@ -186,9 +194,21 @@ void TreeStrategy::smartHierarchy(TreeNode *root, const vector<TreeNode *> &chan
             vector<TreeNode *> nodesToTrain;
             unordered_set<TreeNode *> nextLevelNodes;
 
+            // Leaves sit at different depths, so a level can hold a node together with one of its ancestors. Training
+            // both in one batch would race on the Q-values of the ancestor's region, so the ancestor waits for the next
+            // pass, after its descendants
+            unordered_set<TreeNode *> postponed;
+            for (const TreeNode *node: currentLevelNodes) {
+                for (TreeNode *ancestor = node->parent; ancestor; ancestor = ancestor->parent) {
+                    if (currentLevelNodes.contains(ancestor)) postponed.insert(ancestor);
+                }
+            }
+
             // Process each node in the current level
             for (TreeNode *node: currentLevelNodes) {
-                if (node->baselineSuccessRate < 0) {
+                if (postponed.contains(node)) {
+                    nextLevelNodes.insert(node);
+                } else if (node->baselineSuccessRate < 0) {
                     // Node is untrained
                     nodesToTrain.push_back(node);
                 } else {
@@ -210,7 +230,7 @@ void TreeStrategy::smartHierarchy(TreeNode *root, const vector<TreeNode *> &chan
             if (!nodesToTrain.empty()) {
                 // Train all marked nodes in one batch
                 cout << "Training nodes...\n";
-                trainTreeNodes(root, nodesToTrain, true, trainingMode);
+                trainTreeNodes(root, nodesToTrain, true, trainingMode, rng);
                 cout << "Nodes trained.\n";
                 // Update each trained node's baseline success rate
                 for (const TreeNode *node: nodesToTrain) {
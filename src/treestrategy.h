@@ -1,7 +1,8 @@
 #ifndef TREESTRATEGY_H
 #define TREESTRATEGY_H
 
-#include <thread>
+#include <algorithm>
+#include <numeric>
 #include <unordered_set>
 
 #include "multiagent.h"
@@ -12,20 +13,23 @@ using namespace std;
 
 class TreeStrategy {
 public:
+    // Train a single node with the given mode and share the result with its ancestors and descendants
+    static void trainTreeNode(const TreeNode *root, TreeNode *node, const string &trainingMode, Rng &rng);
+
     static void trainTreeNodesInParallel(const TreeNode *root, const vector<TreeNode *> &nodes,
-                                         const string &trainingMode);
+                                         const string &trainingMode, Rng &rng);
 
     static void trainTreeNodesSequentially(const TreeNode *root, const vector<TreeNode *> &nodes,
-                                           const string &trainingMode);
+                                           const string &trainingMode, Rng &rng);
 
     static void trainTreeNodes(const TreeNode *root, const vector<TreeNode *> &nodes, const bool &parallel,
-                               const string &trainingMode);
+                               const string &trainingMode, Rng &rng);
 
-    static void onlyTrainLeafNodes(TreeNode *root, const vector<TreeNode *> &changedLeaves = {});
+    static void onlyTrainLeafNodes(TreeNode *root, Rng &rng, const vector<TreeNode *> &changedLeaves = {});
 
     static double getRetrainingThreshold(int mazeSize);
 
-    static void smartHierarchy(TreeNode *root, const vector<TreeNode *> &changedLeaves = {},
+    static void smartHierarchy(TreeNode *root, Rng &rng, const vector<TreeNode *> &changedLeaves = {},
                                const string &trainingMode = "singleAgent");
 };
 